@@ -29,6 +29,7 @@ namespace coating
     virtual double unpolarized_transmittance() = 0;
     virtual rotation reflection_rotation() = 0;
     virtual rotation transmission_rotation() = 0;
+    virtual std::shared_ptr<base> clone() const = 0;
     
     void set_direction_parameters(const unit_interval& ui_polar,
 				  const unit_interval& ui_azimuth) {
@@ -64,6 +65,9 @@ namespace coating
     grey_lambert(double reflectivity, double transmissivity)
       : reflectivity_{reflectivity}, transmissivity_{transmissivity}
     {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<grey_lambert>(*this);
+    }
     mueller reflection_mueller_matrix() {
       mueller m;
       m.add(0,0, reflectivity_);
@@ -98,11 +102,17 @@ namespace coating
   class white_lambert : public grey_lambert {
   public:
     white_lambert() : grey_lambert::grey_lambert(1,0) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<white_lambert>(*this);
+    }
   };
 
   class fresnel : public base {   
     flick::fresnel f_;
   public:
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<fresnel>(*this);
+    }
     mueller reflection_mueller_matrix() {
       update_fresnel();
       return reflection_mueller(f_);
@@ -126,12 +136,19 @@ namespace coating
       r.rotate_about_local_x(pi);
       return r;
     }
-    rotation transmission_rotation() {
+    rotation transmission_rotation()
+    // Refraction turns the package within the plane of incidence, so
+    // its azimuth about the normal and its polarization frame are kept
+    {
       update_fresnel();
-      rotation r{-facing_surface_normal_};
-      if(fabs(dot(r.x_direction(),facing_surface_normal_)) > 1e-6)
-	throw std::runtime_error("coating");
-      r.rotate_about_local_x(real(f_.transmission_angle()));
+      rotation r{incidence_};
+      vector axis = cross(incidence_.z_direction(),-facing_surface_normal_);
+      if (norm(axis) > 1e-12) {
+	double theta_i = acos(std::clamp(dot(-incidence_.z_direction(),
+					     facing_surface_normal_),-1.0,1.0));
+	double theta_t = real(f_.transmission_angle());
+	r.rotate_about(normalize(axis),theta_i-theta_t);
+      }
       return r;
     }
   private:
@@ -37,4 +37,16 @@ namespace flick {
     check_small(rms(r.z_direction(),{0,0,1}));
     check_small(rms(t.z_direction(),{0,0,-1}));
   } end_test_case()
+
+  begin_test_case(coating_test_C) {
+    // Refraction keeps the azimuth of oblique incidence
+    coating::fresnel f;
+    double n = 1.33;
+    f.set(relative_refractive_index{n,0});
+    unit_vector d{2.5, 1.2};
+    f.set_incidence(rotation{d});
+    rotation t = f.transmission_rotation();
+    check_close(t.z_direction().phi(),d.phi());
+    check_close(sin(pi-t.z_direction().theta()),sin(pi-d.theta())/n);
+  } end_test_case()
 }
@@ -6,6 +6,7 @@ int main() {
   unit_test t("coating");
   t.include<coating_test_A>();
   t.include<coating_test_B>();
+  t.include<coating_test_C>();
   t.run_test_cases();
   return 0;
 }
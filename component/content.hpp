@@ -14,6 +14,9 @@ namespace flick {
     bool has_material_{false};
     receiver inward_receiver_;
     receiver outward_receiver_;
+    std::vector<double> wavelengths_;
+    std::vector<std::shared_ptr<material::base>> spectral_materials_;
+    material::base* selected_material_{nullptr};
   public:
     template <class Coating, class... Args>
     void coat(Args... a) {
@@ -28,21 +31,52 @@ namespace flick {
     }
     template <class Material, class... Args>
     void fill(Args... a) {
-      material_ = std::make_shared<Material>(a...);
-      if (material_!=nullptr)
-	has_material_ = true;
+      fill(std::make_shared<Material>(a...));
     }
     void fill(std::shared_ptr<material::base> m) {
       material_ = m;
+      clear_spectrum();
       if (material_!=nullptr)
 	has_material_ = true;
     }
     coating::base& coating() const {
       return *coating_;
     }
-    material::base& material() const {
+    material::base& material() const
+    // The copy at the selected wavelength, if set
+    {
+      if (selected_material_)
+	return *selected_material_;
       return *material_;
     }
+    material::base& material(size_t wavelength_number) const {
+      return *spectral_materials_.at(wavelength_number);
+    }
+    void set_spectrum(const std::vector<double>& wavelengths)
+    // Keeps one copy of the material at each wavelength, so that
+    // spectral packages can switch wavelength without recomputing
+    // optical properties
+    {
+      if (wavelengths == wavelengths_ || !has_material_)
+	return;
+      clear_spectrum();
+      for (double wl : wavelengths) {
+	spectral_materials_.push_back(material_->clone());
+	spectral_materials_.back()->set_wavelength(wl);
+      }
+      wavelengths_ = wavelengths;
+    }
+    bool has_spectrum() const {
+      return !spectral_materials_.empty();
+    }
+    void select_wavelength(size_t wavelength_number) {
+      selected_material_ = spectral_materials_.at(wavelength_number).get();
+    }
+    void clear_spectrum() {
+      wavelengths_.clear();
+      spectral_materials_.clear();
+      selected_material_ = nullptr;
+    }
     bool has_coating() const {
       return has_coating_;
     }
@@ -54,7 +88,22 @@ namespace flick {
     }
     receiver& outward_receiver() {
       return outward_receiver_;
-    } 
+    }
+    void detach()
+    // Replace shared material and coating with own copies, so that
+    // copied content can be used concurrently with the original
+    {
+      if (has_material_)
+	material_ = material_->clone();
+      for (size_t i=0; i<spectral_materials_.size(); ++i) {
+	bool is_selected = (selected_material_ == spectral_materials_[i].get());
+	spectral_materials_[i] = spectral_materials_[i]->clone();
+	if (is_selected)
+	  selected_material_ = spectral_materials_[i].get();
+      }
+      if (has_coating_)
+	coating_ = coating_->clone();
+    }
   };
 }
 
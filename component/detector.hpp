@@ -0,0 +1,98 @@
+#ifndef flick_detector
+#define flick_detector
+
+#include <limits>
+#include "../numeric/vector.hpp"
+#include "../environment/input_output.hpp"
+
+namespace flick {
+  class detector
+  // Local estimate detector. At each scattering event the transporter
+  // adds the intensity scattered toward the detector per unit solid
+  // angle, attenuated along the connecting path and divided by the
+  // geometric factor of the detector.
+  {
+  protected:
+    double sum_{0};
+  public:
+    virtual ~detector() = default;
+    virtual std::shared_ptr<detector> clone() const = 0;
+    virtual unit_vector direction_from(const vector& position) const = 0;
+    virtual double distance_from(const vector& position) const = 0;
+    virtual double geometric_factor(const vector& position) const = 0;
+    virtual bool is_reached_at_opaque_surfaces() const = 0;
+    void add(double scattered_intensity, double optical_depth,
+	     const vector& position) {
+      sum_ += scattered_intensity*exp(-optical_depth)/geometric_factor(position);
+    }
+    void add(const detector& d) {
+      sum_ += d.sum_;
+    }
+    void clear() {
+      sum_ = 0;
+    }
+    void write_state(std::ostream& os) const {
+      write_binary(os, sum_);
+    }
+    void read_state(std::istream& is) {
+      read_binary(is, sum_);
+    }
+  };
+
+  class point_detector : public detector
+  // Fluence rate at a point from light scattered at least once
+  {
+    vector position_;
+  public:
+    point_detector(const vector& position) : position_{position} {}
+    std::shared_ptr<detector> clone() const override {
+      return std::make_shared<point_detector>(*this);
+    }
+    unit_vector direction_from(const vector& position) const {
+      return normalize(position_-position);
+    }
+    double distance_from(const vector& position) const {
+      return norm(position_-position);
+    }
+    double geometric_factor(const vector& position) const {
+      return pow(distance_from(position),2);
+    }
+    bool is_reached_at_opaque_surfaces() const {
+      return false;
+    }
+    double fluence_rate() const {
+      return sum_;
+    }
+  };
+
+  class direction_detector : public detector
+  // Radiance propagating in a given direction in plane-parallel
+  // geometry, from light scattered at least once. Light is followed
+  // until it leaves the geometry or reaches an opaque surface, as with
+  // receiver::radiance.
+  {
+    unit_vector direction_;
+  public:
+    direction_detector(const unit_vector& direction) : direction_{direction} {}
+    std::shared_ptr<detector> clone() const override {
+      return std::make_shared<direction_detector>(*this);
+    }
+    unit_vector direction_from(const vector&) const {
+      return direction_;
+    }
+    double distance_from(const vector&) const {
+      return std::numeric_limits<double>::infinity();
+    }
+    double geometric_factor(const vector&) const {
+      return fabs(direction_.mu());
+    }
+    bool is_reached_at_opaque_surfaces() const {
+      return true;
+    }
+    double radiance() const {
+      return sum_;
+    }
+  };
+}
+
+#endif
@@ -9,14 +9,17 @@ namespace flick {
   protected:
     uniform_random ur_;
   public:
-    virtual double draw() = 0;
+    double draw() {
+      return draw(ur_);
+    }
+    virtual double draw(const uniform_random& rnd) = 0;
     virtual ~wavelength_distribution()=default;
   };
   class monocromatic : public wavelength_distribution {
     double wl_;
   public:
     monocromatic(double wl) : wl_{wl} {} 
-    double draw() {
+    double draw(const uniform_random&) {
       return wl_;
     }
   };
@@ -26,8 +29,12 @@ namespace flick {
   class direction_distribution {
   protected:
     direction_generator dg_;
+    uniform_random ur_;
   public:
-    virtual unit_vector draw() = 0;
+    unit_vector draw() {
+      return draw(ur_);
+    }
+    virtual unit_vector draw(const uniform_random& rnd) = 0;
     virtual ~direction_distribution()=default;
   };
 
@@ -35,7 +42,7 @@ namespace flick {
     unit_vector direction_;
   public:
     unidirectional(const unit_vector& d) : direction_{d}{}
-    unit_vector draw() {
+    unit_vector draw(const uniform_random&) {
       return direction_;
     }
   };
@@ -46,16 +53,16 @@ namespace flick {
   public:
     conic(double solid_angle, const unit_vector& cone_direction)
       : cone_direction_{cone_direction}, solid_angle_{solid_angle} {} 
-    unit_vector draw() {
-      return dg_.conic(solid_angle_, cone_direction_);
+    unit_vector draw(const uniform_random& rnd) {
+      return dg_.conic(solid_angle_, cone_direction_, rnd);
     }
   };
   
   class isotropic : public direction_distribution {
   public:
     isotropic() {} 
-    unit_vector draw() {
-      return dg_.isotropic();
+    unit_vector draw(const uniform_random& rnd) {
+      return dg_.isotropic(rnd);
     }
   };
 
@@ -67,6 +74,9 @@ namespace flick {
     stokes initial_stokes_{1,0,0,0};
     std::shared_ptr<wavelength_distribution> wld_;
     std::shared_ptr<direction_distribution> dd_;
+    std::shared_ptr<const spectral_grid> grid_;
+    std::vector<double> cumulative_;
+    uniform_random ur_;
   public:
     emitter() = default;
     emitter(vector position, const stokes& initial_stokes, size_t n_packages)
@@ -90,15 +100,85 @@ namespace flick {
     void set_direction(Args... a) {
       dd_ = std::make_shared<Dd>(a...);
     }
+    void set_spectrum(const pp_function& spectrum,
+		      const std::vector<double>& wavelengths)
+    // Packages carry all wavelengths. The hero wavelength is drawn in
+    // proportion to the emitted power in its band, where bands are
+    // bounded by the midpoints between wavelengths. Received weights
+    // are fractions of the power emitted in all bands.
+    {
+      size_t n = wavelengths.size();
+      if (n == 0)
+	throw std::runtime_error("emitter spectrum");
+      auto grid = std::make_shared<spectral_grid>();
+      grid->wavelengths = wavelengths;
+      grid->probabilities.assign(n, 1.0);
+      for (size_t i=0; n > 1 && i<n; ++i) {
+	double low = (i > 0) ? 0.5*(wavelengths[i-1]+wavelengths[i])
+	  : 1.5*wavelengths[0]-0.5*wavelengths[1];
+	double high = (i+1 < n) ? 0.5*(wavelengths[i]+wavelengths[i+1])
+	  : 1.5*wavelengths[n-1]-0.5*wavelengths[n-2];
+	grid->probabilities[i] = spectrum.integral(low, high);
+      }
+      cumulative_.resize(n);
+      double sum = 0;
+      for (size_t i=0; i<n; ++i) {
+	sum += grid->probabilities[i];
+	cumulative_[i] = sum;
+      }
+      if (!(sum > 0))
+	throw std::runtime_error("emitter spectrum");
+      for (size_t i=0; i<n; ++i) {
+	grid->probabilities[i] /= sum;
+	cumulative_[i] /= sum;
+      }
+      grid_ = grid;
+    }
+    bool is_spectral() const {
+      return grid_ != nullptr;
+    }
+    const std::vector<double>& wavelengths() const
+    // Wavelengths carried by spectral packages
+    {
+      return grid_->wavelengths;
+    }
     radiation_package emit()
     {
-      pose p{position_, dd_->draw()};
-      radiation_package rp(p, initial_stokes_);
-      rp.emission_direction(p.direction());
-      rp.wavelength(wld_->draw());
-      --packages_left_;
-      return rp;
-    }    
+      unit_vector direction = dd_->draw();
+      if (grid_)
+	return emit(direction, draw_hero(ur_()));
+      return emit(direction, wld_->draw());
+    }
+    radiation_package emit(const uniform_random& rnd)
+    // Emit using given random number stream instead of the
+    // distributions' own generators
+    {
+      unit_vector direction = dd_->draw(rnd);
+      if (grid_)
+	return emit(direction, draw_hero(rnd()));
+      return emit(direction, wld_->draw(rnd));
+    }
+    std::vector<emitter> split(size_t n_parts) const
+    // Divide packages left between emitters with equal source
+    // properties. Parts are to be emitted with separate random number
+    // streams, since the distributions are shared.
+    {
+      std::vector<emitter> parts(n_parts, *this);
+      for (size_t i=0; i<n_parts; ++i) {
+	parts[i].packages_left_ = packages_left_/n_parts
+	  + (i < packages_left_%n_parts ? 1 : 0);
+      }
+      return parts;
+    }
+    emitter take(size_t n_packages)
+    // Emitter of n_packages of the packages left, or of all if fewer
+    // are left, which are removed from this one
+    {
+      emitter part = *this;
+      part.packages_left_ = std::min(n_packages, packages_left_);
+      packages_left_ -= part.packages_left_;
+      return part;
+    }
     size_t packages_left() const {
       return packages_left_;
     }
@@ -109,6 +189,25 @@ namespace flick {
       os << em.position_ << " " << em.initial_stokes_  << " " << em.packages_left_;
       return os;
     }
+  private:
+    radiation_package emit(const unit_vector& direction, double wavelength) {
+      pose p{position_, direction};
+      radiation_package rp(p, initial_stokes_);
+      rp.emission_direction(p.direction());
+      rp.wavelength(wavelength);
+      --packages_left_;
+      return rp;
+    }
+    radiation_package emit(const unit_vector& direction, size_t hero) {
+      radiation_package rp = emit(direction, grid_->wavelengths[hero]);
+      rp.set_spectrum(grid_, hero);
+      return rp;
+    }
+    size_t draw_hero(double fraction) const {
+      size_t i = std::upper_bound(cumulative_.begin(), cumulative_.end(),
+				  fraction) - cumulative_.begin();
+      return std::min(i, cumulative_.size()-1);
+    }
   };
 }
 
@@ -0,0 +1,207 @@
+#ifndef flick_event_stream
+#define flick_event_stream
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "radiation_package.hpp"
+
+namespace flick {
+  enum class event_column
+  // Properties of received packages, in the order they are stored
+  {x, y, z, ux, uy, uz, I, Q, U, V, traveling_length, wavelength,
+   spectral_weight};
+
+  class event_buffer
+  // Received packages kept as one column per property until they
+  // are written as a block
+  {
+  public:
+    static constexpr size_t n_columns = 13;
+  private:
+    std::array<std::vector<double>, n_columns> columns_;
+  public:
+    size_t size() const {
+      return columns_[0].size();
+    }
+    void add(const radiation_package& rp) {
+      const vector& p = rp.pose().position();
+      const unit_vector& d = rp.pose().z_direction();
+      const stokes& s = rp.stokes();
+      double values[n_columns] = {p.x(), p.y(), p.z(), d.x(), d.y(), d.z(),
+	s.I(), s.Q(), s.U(), s.V(), rp.traveling_length(), rp.wavelength(),
+	rp.spectral_weight()};
+      for (size_t i=0; i<n_columns; ++i)
+	columns_[i].push_back(values[i]);
+    }
+    const std::vector<double>& column(size_t i) const {
+      return columns_[i];
+    }
+    void clear() {
+      for (auto& c : columns_)
+	c.clear();
+    }
+  };
+
+  class event_stream
+  // Binary file of received packages. After a header with the number
+  // of columns, the file holds blocks of packages, each with the
+  // number of packages followed by one column of doubles per
+  // property. Receivers in different threads write whole blocks, one
+  // at a time.
+  {
+    std::ofstream ofs_;
+    std::mutex mutex_;
+    size_t n_events_{0};
+  public:
+    static constexpr char magic[8] = {'f','l','i','c','k','e','v','1'};
+    event_stream(const std::string& file_name)
+      : ofs_{file_name, std::ios::binary | std::ios::trunc} {
+      if (!ofs_)
+	throw std::runtime_error("event_stream");
+      uint64_t n = event_buffer::n_columns;
+      ofs_.write(magic, sizeof(magic));
+      ofs_.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    }
+    void write(const event_buffer& b) {
+      uint64_t n = b.size();
+      if (n == 0)
+	return;
+      std::lock_guard<std::mutex> lock(mutex_);
+      ofs_.write(reinterpret_cast<const char*>(&n), sizeof(n));
+      for (size_t i=0; i<event_buffer::n_columns; ++i)
+	ofs_.write(reinterpret_cast<const char*>(b.column(i).data()),
+		   n*sizeof(double));
+      if (!ofs_)
+	throw std::runtime_error("event_stream write");
+      n_events_ += n;
+    }
+    size_t n_events() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return n_events_;
+    }
+    void flush() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ofs_.flush();
+    }
+  };
+
+  class event_file
+  // Read-only memory map of a file written by event_stream. Columns
+  // of each block are contiguous arrays in the map.
+  {
+    struct block {
+      size_t n;
+      size_t offset;
+      size_t first;
+    };
+    int fd_{-1};
+    const char* data_{nullptr};
+    size_t file_size_{0};
+    std::vector<block> blocks_;
+    size_t n_events_{0};
+  public:
+    event_file(const std::string& file_name) {
+      fd_ = open(file_name.c_str(), O_RDONLY);
+      if (fd_ < 0)
+	throw std::runtime_error("event_file");
+      struct stat st;
+      if (fstat(fd_, &st) != 0) {
+	close(fd_);
+	throw std::runtime_error("event_file");
+      }
+      file_size_ = st.st_size;
+      if (file_size_ > 0) {
+	void* p = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+	if (p == MAP_FAILED) {
+	  close(fd_);
+	  throw std::runtime_error("event_file");
+	}
+	data_ = static_cast<const char*>(p);
+      }
+      try {
+	index_blocks();
+      } catch (...) {
+	release();
+	throw;
+      }
+    }
+    event_file(const event_file&) = delete;
+    event_file& operator=(const event_file&) = delete;
+    ~event_file() {
+      release();
+    }
+    size_t size() const {
+      return n_events_;
+    }
+    size_t n_blocks() const {
+      return blocks_.size();
+    }
+    size_t block_size(size_t b) const {
+      return blocks_.at(b).n;
+    }
+    const double* column(size_t b, event_column c) const
+    // Values of one property for the packages of block b
+    {
+      const block& bl = blocks_.at(b);
+      return reinterpret_cast<const double*>(data_ + bl.offset)
+	+ static_cast<size_t>(c)*bl.n;
+    }
+    double value(event_column c, size_t i) const
+    // Value of one property for package number i in the file
+    {
+      if (i >= n_events_)
+	throw std::runtime_error("event_file index");
+      auto it = std::upper_bound(blocks_.begin(), blocks_.end(), i,
+				 [](size_t i, const block& b) {
+				   return i < b.first;
+				 });
+      const block& bl = *(it-1);
+      return column(it-1-blocks_.begin(), c)[i-bl.first];
+    }
+  private:
+    void index_blocks() {
+      size_t header = sizeof(event_stream::magic) + sizeof(uint64_t);
+      if (file_size_ < header
+	  || std::memcmp(data_, event_stream::magic, sizeof(event_stream::magic)) != 0)
+	throw std::runtime_error("event_file format");
+      uint64_t n_columns = read_uint64(sizeof(event_stream::magic));
+      if (n_columns != event_buffer::n_columns)
+	throw std::runtime_error("event_file format");
+      size_t offset = header;
+      while (offset < file_size_) {
+	if (offset + sizeof(uint64_t) > file_size_)
+	  throw std::runtime_error("event_file format");
+	uint64_t n = read_uint64(offset);
+	offset += sizeof(uint64_t);
+	if (n > (file_size_-offset)/(n_columns*sizeof(double)))
+	  throw std::runtime_error("event_file format");
+	size_t bytes = n*n_columns*sizeof(double);
+	blocks_.push_back({n, offset, n_events_});
+	n_events_ += n;
+	offset += bytes;
+      }
+    }
+    void release() {
+      if (data_)
+	munmap(const_cast<char*>(data_), file_size_);
+      if (fd_ >= 0)
+	close(fd_);
+      data_ = nullptr;
+      fd_ = -1;
+    }
+    uint64_t read_uint64(size_t offset) const {
+      uint64_t n;
+      std::memcpy(&n, data_ + offset, sizeof(n));
+      return n;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include <filesystem>
+#include "receiver.hpp"
+
+namespace flick {
+  begin_test_case(event_stream_test) {
+    std::string file = "./tmp_events.bin";
+    size_t n = 10000;
+    {
+      receiver re;
+      re.activate();
+      re.stream_to(std::make_shared<event_stream>(file));
+      for (size_t i=0; i<n; ++i) {
+	radiation_package rp({{double(i),0,-1},{0,0}},stokes{1,0,0,0});
+	rp.traveling_length(0.5*i);
+	re.receive(rp);
+      }
+      check(re.received_packages() == n);
+      check(re.is_streaming());
+      re.flush();
+    }
+    {
+      event_file ef(file);
+      check(ef.size() == n);
+      check(ef.n_blocks() == 3);
+      check(ef.block_size(0) == 4096);
+      check_close(ef.value(event_column::x, 5000), 5000);
+      check_close(ef.value(event_column::z, n-1), -1);
+      check_close(ef.value(event_column::traveling_length, 10), 5);
+      double I = 0;
+      for (size_t b=0; b<ef.n_blocks(); ++b) {
+	const double* c = ef.column(b, event_column::I);
+	for (size_t i=0; i<ef.block_size(b); ++i)
+	  I += c[i];
+      }
+      check_close(I, n);
+      check_throw(ef.value(event_column::x, n));
+    }
+    {
+      // A block running past the end of the file should be rejected,
+      // leaving no descriptor open
+      std::ofstream ofs(file, std::ios::binary | std::ios::trunc);
+      uint64_t header[2] = {event_buffer::n_columns, uint64_t(1) << 62};
+      ofs.write(event_stream::magic, sizeof(event_stream::magic));
+      ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+    int fd = open(file.c_str(), O_RDONLY);
+    close(fd);
+    check_throw(event_file{file});
+    int next_fd = open(file.c_str(), O_RDONLY);
+    close(next_fd);
+    check(next_fd == fd);
+    std::filesystem::remove(file);
+    check_throw(event_file{file});
+  } end_test_case()
+}
@@ -6,6 +6,14 @@
 #include "../polarization/algorithm.hpp"
 
 namespace flick {
+  struct spectral_grid
+  // Wavelengths carried by spectral packages, and the probabilities
+  // with which each of them is drawn as hero wavelength
+  {
+    std::vector<double> wavelengths;
+    std::vector<double> probabilities;
+  };
+
   class radiation_package
   {
     flick::pose pose_;
@@ -13,6 +21,10 @@ namespace flick {
     flick::stokes stokes_{1,0,0,0};
     double traveling_length_{0};
     unit_vector emission_direction_;
+    std::shared_ptr<const spectral_grid> grid_;
+    size_t hero_{0};
+    std::vector<double> throughput_ratios_;
+    std::vector<double> pdf_ratios_;
     //size_t scattering_events_{0};?
     //bool do_not_scatter_?
   public:
@@ -53,12 +65,24 @@ namespace flick {
       pose_.rotate_about_local_z(angle);
       stokes_.rotate(-angle);
     }
+    double weight() const
+    // Intensity, or for spectral packages the intensity at the
+    // wavelength with largest throughput
+    {
+      double t = 1;
+      if (is_spectral())
+	t = *std::max_element(throughput_ratios_.begin(), throughput_ratios_.end());
+      return stokes_.I()*t;
+    }
     bool is_empty() const {
-      return (stokes_.I() < 1e-9);
+      return (weight() < 1e-9);
     }
     double traveling_length() const {
       return traveling_length_;
     }
+    void traveling_length(double l) {
+      traveling_length_ = l;
+    }
     const unit_vector& emission_direction() const {
       return emission_direction_;
     }
@@ -74,6 +98,60 @@ namespace flick {
     const flick::stokes& stokes() const {
       return stokes_;
     }
+    void set_spectrum(const std::shared_ptr<const spectral_grid>& grid,
+		      size_t hero)
+    // The path is sampled with the hero wavelength, while the other
+    // wavelengths of the grid follow it with their own weights, see
+    // Wilkie et al. 2014, Hero wavelength spectral sampling.
+    {
+      grid_ = grid;
+      hero_ = hero;
+      wavelength_ = grid->wavelengths.at(hero);
+      throughput_ratios_.assign(grid->wavelengths.size(), 1.0);
+      pdf_ratios_.assign(grid->wavelengths.size(), 1.0);
+    }
+    bool is_spectral() const {
+      return grid_ != nullptr;
+    }
+    size_t hero() const {
+      return hero_;
+    }
+    size_t n_wavelengths() const {
+      return throughput_ratios_.size();
+    }
+    void scale_spectrum(size_t i, double throughput_factor, double pdf_factor)
+    // Factors are relative to those of the hero wavelength, for the
+    // contribution of the path and for the density it was sampled
+    // with
+    {
+      throughput_ratios_[i] *= throughput_factor;
+      pdf_ratios_[i] *= pdf_factor;
+    }
+    template<class F>
+    void for_each_wavelength(F f) const
+    // Calls f(wavelength, weight) for each carried wavelength, where
+    // the Stokes vector times weight is the contribution at that
+    // wavelength. Weights follow the balance heuristic over all
+    // wavelengths as hero. Monocromatic packages have weight one.
+    {
+      if (!is_spectral()) {
+	f(wavelength_, 1.0);
+	return;
+      }
+      const std::vector<double>& p = grid_->probabilities;
+      double sum = 0;
+      for (size_t i=0; i<pdf_ratios_.size(); ++i)
+	sum += p[i]*pdf_ratios_[i];
+      for (size_t i=0; i<throughput_ratios_.size(); ++i)
+	f(grid_->wavelengths[i], p[i]*throughput_ratios_[i]/sum);
+    }
+    double spectral_weight() const
+    // Sum of weights over wavelengths
+    {
+      double w = 0;
+      for_each_wavelength([&w](double, double weight) {w += weight;});
+      return w;
+    }
     friend std::ostream& operator<<(std::ostream &os,
 				    const radiation_package& rp) {
       os << "xyz " << rp.pose_.position() << ", dir "<<rp.pose_.z_direction()
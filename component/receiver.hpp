@@ -1,42 +1,162 @@
 #ifndef flick_receiver
 #define flick_receiver
 
-#include "radiation_package.hpp"
-#include "../numeric/histogram.hpp"
+#include "tally.hpp"
+#include <memory>
+#include "event_stream.hpp"
 
 namespace flick {
   class receiver
+  // Stores received packages, or accumulates them into a tally when
+  // one is in use. Packages may also be streamed to a file instead of
+  // being stored.
   {
     std::vector<radiation_package> rps_;
+    std::optional<flick::tally> tally_;
     bool is_active_{false};
+    std::shared_ptr<event_stream> stream_;
+    event_buffer buffer_;
+    size_t n_streamed_{0};
+    static constexpr size_t block_size_{4096};
   public:
     void clear() {
       rps_.clear();
       rps_.shrink_to_fit();
+      if (tally_)
+	tally_->clear();
+      buffer_.clear();
+      n_streamed_ = 0;
     }
     void receive(const radiation_package& rp) {
-      if (is_active_)
+      if (!is_active_)
+	return;
+      if (stream_) {
+	buffer_.add(rp);
+	n_streamed_++;
+	if (buffer_.size() >= block_size_)
+	  flush();
+      }
+      if (tally_)
+	tally_->add(rp);
+      else if (!stream_)
 	rps_.emplace_back(rp);
     }
     size_t received_packages() {
-      return rps_.size();
+      if (tally_)
+	return tally_->received_packages();
+      return rps_.size() + n_streamed_;
+    }
+    void stream_to(std::shared_ptr<event_stream> s)
+    // Packages are written to s in blocks instead of being stored,
+    // so that memory use does not grow with the number of packages.
+    // A tally in use is still accumulated. Copies of the receiver
+    // write to the same stream.
+    {
+      stream_ = s;
+      for (auto& rp : rps_)
+	buffer_.add(rp);
+      n_streamed_ += rps_.size();
+      rps_.clear();
+      rps_.shrink_to_fit();
+    }
+    bool is_streaming() const {
+      return stream_ != nullptr;
+    }
+    void flush()
+    // Writes packages waiting in the buffer to the stream
+    {
+      if (!stream_)
+	return;
+      stream_->write(buffer_);
+      buffer_.clear();
     }
     void activate() {
       is_active_ = true;
     }
+    bool is_active() const {
+      return is_active_;
+    }
+    void use(const flick::tally& t)
+    // Accumulate packages into t instead of storing them
+    {
+      tally_ = t;
+      tally_->clear();
+      for (auto& rp : rps_)
+	tally_->add(rp);
+      rps_.clear();
+      rps_.shrink_to_fit();
+    }
+    bool has_tally() const {
+      return tally_.has_value();
+    }
+    const flick::tally& tally() const {
+      return tally_.value();
+    }
+    void add(const receiver& r)
+    // Merge packages received by another receiver. Streamed packages
+    // are in the file already, once the other receiver is flushed.
+    {
+      n_streamed_ += r.n_streamed_;
+      if (tally_ && r.tally_)
+	tally_->add(*r.tally_);
+      else if (tally_)
+	for (auto& rp : r.rps_)
+	  tally_->add(rp);
+      else if (r.tally_)
+	throw std::runtime_error("receiver merge");
+      else
+	rps_.insert(rps_.end(), r.rps_.begin(), r.rps_.end());
+    }
+    void write_state(std::ostream& os) const
+    // Tallied sums of active receivers. Stored and streamed packages
+    // are not part of the state.
+    {
+      if (!is_active_)
+	return;
+      if (!tally_ || stream_)
+	throw std::runtime_error("receiver state");
+      tally_->write_state(os);
+    }
+    void read_state(std::istream& is) {
+      if (!is_active_)
+	return;
+      if (!tally_ || stream_)
+	throw std::runtime_error("receiver state");
+      tally_->read_state(is);
+    }
     double radiant_flux() {
+      if (tally_)
+	return tally_->radiant_flux();
       double rf = 0;
       for(size_t i = 0; i < rps_.size(); ++i)
-	rf += rps_[i].stokes().I();
+	rf += rps_[i].stokes().I()*rps_[i].spectral_weight();
       return rf;
     }
+    std::vector<double> spectral_radiant_flux()
+    // Radiant flux for each wavelength bin of the tally, or for each
+    // wavelength carried by stored spectral packages
+    {
+      if (tally_)
+	return tally_->spectral_radiant_flux();
+      std::vector<double> f;
+      for (auto& rp : rps_) {
+	f.resize(std::max<size_t>(rp.n_wavelengths(), 1), 0.0);
+	size_t i = 0;
+	rp.for_each_wavelength([&](double, double weight) {
+	  f.at(i++) += rp.stokes().I()*weight;
+	});
+      }
+      return f;
+    }
     double radiance(const unit_vector& direction, double acceptance_angle) {
+      if (tally_)
+	return tally_->radiance(direction, acceptance_angle);
       double sum = 0;
       for(size_t i = 0; i < rps_.size(); ++i) {
 	unit_vector prop_dir = rps_[i].pose().z_direction(); 
 	double mu = dot(prop_dir,direction);
 	if (mu > cos(acceptance_angle)) {
-	  sum += rps_[i].stokes().I() / fabs(prop_dir.mu());
+	  sum += rps_[i].stokes().I()*rps_[i].spectral_weight() / fabs(prop_dir.mu());
 	}
       }
       double solid_angle = 2*constants::pi*(1-cos(acceptance_angle));
@@ -44,12 +164,16 @@ namespace flick {
       return L;
     }
     double mean_traveling_length() const {
+      if (tally_)
+	return tally_->mean_traveling_length();
       double l = 0;
       for(size_t i=0; i<rps_.size(); ++i)
 	l += rps_[i].traveling_length();
       return l/rps_.size();
     }
     histogram polar_angle_distribution(size_t n_emitter, size_t n_receiver) {
+      if (tally_)
+	return tally_->polar_angle_distribution(n_emitter, n_receiver);
       double epsilon = 1e-9;
       equal_bins x_bins{-epsilon, 1+epsilon, n_emitter};
       equal_bins y_bins{-epsilon, 1+epsilon, n_receiver};
@@ -58,7 +182,7 @@ namespace flick {
 	double x = rps_[i].emission_direction().mu();
 	unit_vector surf_normal = {0,0,1};
 	double y = dot(rps_[i].pose().z_direction(),surf_normal);
-	h.add(x,y,rps_[i].stokes().I());
+	h.add(x,y,rps_[i].stokes().I()*rps_[i].spectral_weight());
       }
       return h;
     }
@@ -0,0 +1,245 @@
+#ifndef flick_tally
+#define flick_tally
+
+#include <limits>
+#include <optional>
+#include <algorithm>
+#include "radiation_package.hpp"
+#include "../numeric/histogram.hpp"
+
+namespace flick {
+  class tally
+  // Weights of received packages accumulated into bins of propagation
+  // direction (mu and phi), position (x and y) and wavelength. Each
+  // bin holds the summed Stokes vector and the summed I/|mu| needed
+  // for radiance. Memory use is set by the number of bins, not by the
+  // number of packages. Packages outside the position or wavelength
+  // ranges count in the totals only.
+  {
+    struct cone {
+      unit_vector direction;
+      double acceptance_angle;
+      double sum;
+    };
+    static constexpr size_t n_values_ = 5;
+    static constexpr double inf_ = std::numeric_limits<double>::infinity();
+    equal_bins mu_bins_{-1,1,1};
+    equal_bins phi_bins_{0,2*constants::pi,1};
+    equal_bins x_bins_{-inf_,inf_,1};
+    equal_bins y_bins_{-inf_,inf_,1};
+    equal_bins wl_bins_{0,inf_,1};
+    std::vector<double> sums_;
+    std::vector<cone> cones_;
+    size_t n_emitter_{0};
+    size_t n_receiver_{0};
+    histogram polar_angles_;
+    size_t n_packages_{0};
+    double radiant_flux_{0};
+    double traveling_length_{0};
+  public:
+    tally() {
+      resize();
+    }
+    tally& direction_bins(size_t n_mu, size_t n_phi) {
+      mu_bins_.n = n_mu;
+      phi_bins_.n = n_phi;
+      resize();
+      return *this;
+    }
+    tally& position_bins(const equal_bins& x, const equal_bins& y) {
+      x_bins_ = x;
+      y_bins_ = y;
+      resize();
+      return *this;
+    }
+    tally& wavelength_bins(const equal_bins& wl) {
+      wl_bins_ = wl;
+      resize();
+      return *this;
+    }
+    tally& polar_angle_bins(size_t n_emitter, size_t n_receiver)
+    // Emission versus received polar angle, see
+    // receiver::polar_angle_distribution. Only packages emitted and
+    // received in the upper hemisphere are counted.
+    {
+      n_emitter_ = n_emitter;
+      n_receiver_ = n_receiver;
+      resize();
+      return *this;
+    }
+    tally& radiance_cone(const unit_vector& direction, double acceptance_angle)
+    // Radiance in this cone is tallied exactly
+    {
+      cones_.push_back({direction, acceptance_angle, 0});
+      return *this;
+    }
+    void clear() {
+      resize();
+    }
+    void add(const radiation_package& rp)
+    // Spectral packages add to the bin of each carried wavelength
+    {
+      n_packages_++;
+      traveling_length_ += rp.traveling_length();
+      rp.for_each_wavelength([&](double wavelength, double weight) {
+	add(rp, wavelength, weight);
+      });
+    }
+    void add(const tally& t)
+    // Merge partial tallies with equal binning
+    {
+      if (sums_.size() != t.sums_.size() || cones_.size() != t.cones_.size()
+	  || n_emitter_ != t.n_emitter_ || n_receiver_ != t.n_receiver_)
+	throw std::runtime_error("tally merge");
+      for (size_t i=0; i<sums_.size(); ++i)
+	sums_[i] += t.sums_[i];
+      for (size_t i=0; i<cones_.size(); ++i)
+	cones_[i].sum += t.cones_[i].sum;
+      if (n_emitter_ > 0)
+	polar_angles_.add(t.polar_angles_);
+      n_packages_ += t.n_packages_;
+      radiant_flux_ += t.radiant_flux_;
+      traveling_length_ += t.traveling_length_;
+    }
+    void write_state(std::ostream& os) const
+    // Sums, to be read back into a tally with equal binning
+    {
+      write_binary(os, sums_);
+      for (const cone& c : cones_)
+	write_binary(os, c.sum);
+      if (n_emitter_ > 0)
+	polar_angles_.write_state(os);
+      write_binary(os, n_packages_);
+      write_binary(os, radiant_flux_);
+      write_binary(os, traveling_length_);
+    }
+    void read_state(std::istream& is) {
+      std::vector<double> sums;
+      read_binary(is, sums);
+      if (sums.size() != sums_.size())
+	throw std::runtime_error("tally state");
+      sums_ = sums;
+      for (cone& c : cones_)
+	read_binary(is, c.sum);
+      if (n_emitter_ > 0)
+	polar_angles_.read_state(is);
+      read_binary(is, n_packages_);
+      read_binary(is, radiant_flux_);
+      read_binary(is, traveling_length_);
+    }
+    size_t received_packages() const {
+      return n_packages_;
+    }
+    double radiant_flux() const {
+      return radiant_flux_;
+    }
+    double mean_traveling_length() const {
+      return traveling_length_/n_packages_;
+    }
+    double radiance(const unit_vector& direction, double acceptance_angle) const
+    // From a registered cone if there is one. Otherwise from the
+    // direction bins with centers inside the cone, divided by their
+    // total solid angle.
+    {
+      for (auto& c : cones_)
+	if (c.acceptance_angle == acceptance_angle
+	    && dot(c.direction,direction) > 1-1e-12)
+	  return c.sum/(2*constants::pi*(1-cos(acceptance_angle)));
+      double sum = 0;
+      size_t n_inside = 0;
+      for (size_t i=0; i<mu_bins_.n; ++i) {
+	for (size_t j=0; j<phi_bins_.n; ++j) {
+	  unit_vector center{acos(mu_bins_.midpoint(i)), phi_bins_.midpoint(j)};
+	  if (dot(center,direction) > cos(acceptance_angle)) {
+	    n_inside++;
+	    for (size_t k=0; k<spatial_spectral_bins(); ++k)
+	      sum += sums_[n_values_*((i*phi_bins_.n+j)*spatial_spectral_bins()+k)+4];
+	  }
+	}
+      }
+      if (n_inside == 0)
+	throw std::runtime_error("tally radiance resolution");
+      double bin_solid_angle = (mu_bins_.max-mu_bins_.min)/mu_bins_.n *
+	(phi_bins_.max-phi_bins_.min)/phi_bins_.n;
+      return sum/(n_inside*bin_solid_angle);
+    }
+    stokes bin_stokes(size_t i_mu, size_t i_phi, size_t i_x=0, size_t i_y=0,
+		      size_t i_wl=0) const {
+      const double* b = &sums_.at(n_values_*bin(i_mu,i_phi,i_x,i_y,i_wl));
+      return stokes{b[0],b[1],b[2],b[3]};
+    }
+    histogram polar_angle_distribution(size_t n_emitter, size_t n_receiver) const {
+      if (n_emitter != n_emitter_ || n_receiver != n_receiver_)
+	throw std::runtime_error("tally polar angle bins");
+      return polar_angles_;
+    }
+    std::vector<double> spectral_radiant_flux() const
+    // Radiant flux in each wavelength bin
+    {
+      std::vector<double> f(wl_bins_.n, 0.0);
+      for (size_t i=0; i<sums_.size()/n_values_; ++i)
+	f[i%wl_bins_.n] += sums_[n_values_*i];
+      return f;
+    }
+  private:
+    void add(const radiation_package& rp, double wavelength, double weight) {
+      const stokes& s = rp.stokes();
+      double I = s.I()*weight;
+      const unit_vector& dir = rp.pose().z_direction();
+      double mu = dir.mu();
+      radiant_flux_ += I;
+      for (auto& c : cones_)
+	if (dot(dir,c.direction) > cos(c.acceptance_angle))
+	  c.sum += I/fabs(mu);
+      if (n_emitter_ > 0 && rp.emission_direction().mu() >= 0 && mu >= 0)
+	polar_angles_.add(rp.emission_direction().mu(), mu, I);
+      const vector& p = rp.pose().position();
+      std::optional<size_t> i_x = index(x_bins_, p.x());
+      std::optional<size_t> i_y = index(y_bins_, p.y());
+      std::optional<size_t> i_wl = index(wl_bins_, wavelength);
+      if (!i_x || !i_y || !i_wl)
+	return;
+      size_t i_mu = clamped_index(mu_bins_, mu);
+      size_t i_phi = clamped_index(phi_bins_, dir.phi());
+      double* b = &sums_[n_values_*bin(i_mu,i_phi,*i_x,*i_y,*i_wl)];
+      b[0] += I;
+      b[1] += s.Q()*weight;
+      b[2] += s.U()*weight;
+      b[3] += s.V()*weight;
+      b[4] += I/fabs(mu);
+    }
+    void resize() {
+      sums_.assign(n_values_*mu_bins_.n*phi_bins_.n*spatial_spectral_bins(), 0.0);
+      for (auto& c : cones_)
+	c.sum = 0;
+      double epsilon = 1e-9;
+      if (n_emitter_ > 0)
+	polar_angles_ = histogram(equal_bins{-epsilon, 1+epsilon, n_emitter_},
+				  equal_bins{-epsilon, 1+epsilon, n_receiver_});
+      n_packages_ = 0;
+      radiant_flux_ = 0;
+      traveling_length_ = 0;
+    }
+    size_t spatial_spectral_bins() const {
+      return x_bins_.n*y_bins_.n*wl_bins_.n;
+    }
+    size_t bin(size_t i_mu, size_t i_phi, size_t i_x, size_t i_y,
+	       size_t i_wl) const {
+      return (((i_mu*phi_bins_.n + i_phi)*x_bins_.n + i_x)*y_bins_.n
+	      + i_y)*wl_bins_.n + i_wl;
+    }
+    static std::optional<size_t> index(const equal_bins& b, double x) {
+      if (x < b.min || x >= b.max)
+	return std::nullopt;
+      if (b.n == 1)
+	return 0;
+      return std::min<size_t>(b.n*(x-b.min)/(b.max-b.min), b.n-1);
+    }
+    static size_t clamped_index(const equal_bins& b, double x) {
+      double i = b.n*(x-b.min)/(b.max-b.min);
+      return std::clamp<double>(i, 0, b.n-1);
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,56 @@
+#include "tally.hpp"
+#include "receiver.hpp"
+
+namespace flick {
+  begin_test_case(tally_test) {
+    unit_vector up{0,0,1};
+    tally t;
+    t.direction_bins(20,4).wavelength_bins({400e-9,700e-9,3});
+    t.radiance_cone(up,0.5).polar_angle_bins(3,4);
+    receiver stored;
+    stored.activate();
+    receiver tallied;
+    tallied.activate();
+    tallied.use(t);
+    receiver first_half = tallied;
+    receiver second_half = tallied;
+    uniform_random rnd(1);
+    direction_generator dg(rnd);
+    for (size_t i=0; i<1000; ++i) {
+      radiation_package rp({{0,0,0},{0,0}},stokes{1,0.5,0,0});
+      rp.emission_direction(dg.lambertian(up));
+      rp.rotate_to(rotation_to(dg.lambertian(up)));
+      rp.wavelength(rnd(400e-9,700e-9));
+      rp.move(1);
+      stored.receive(rp);
+      tallied.receive(rp);
+      if (i < 500)
+	first_half.receive(rp);
+      else
+	second_half.receive(rp);
+    }
+    first_half.add(second_half);
+    check(tallied.received_packages()==1000);
+    check_close(tallied.radiant_flux(),stored.radiant_flux());
+    check_close(first_half.radiant_flux(),stored.radiant_flux());
+    check_close(tallied.mean_traveling_length(),stored.mean_traveling_length());
+    check_close(tallied.radiance(up,0.5),stored.radiance(up,0.5));
+    check_close(first_half.radiance(up,0.5),stored.radiance(up,0.5));
+    check_close(tallied.radiance(up,1),stored.radiance(up,1),10);
+    histogram h_s = stored.polar_angle_distribution(3,4);
+    histogram h_t = tallied.polar_angle_distribution(3,4);
+    check_close(h_t.bin_value(2,3),h_s.bin_value(2,3));
+    check_throw(tallied.polar_angle_distribution(2,2));
+    const tally& r = tallied.tally();
+    double q = 0;
+    for (size_t i=0; i<20; ++i)
+      for (size_t j=0; j<4; ++j)
+	for (size_t k=0; k<3; ++k)
+	  q += r.bin_stokes(i,j,0,0,k).Q();
+    check_close(q,500);
+    receiver unbinned;
+    unbinned.activate();
+    unbinned.use(tally().direction_bins(20,4));
+    check_throw(unbinned.add(tallied));
+  } end_test_case()
+}
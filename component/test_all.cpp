@@ -1,14 +1,18 @@
 #include "../environment/unit_test.hpp"
 #include "emitter_test.hpp"
 #include "receiver_test.hpp"
+#include "tally_test.hpp"
 #include "content_test.hpp"
+#include "event_stream_test.hpp"
 
 int main() {
   using namespace flick;
   unit_test t("component");
   t.include<emitter_test>();
   t.include<receiver_test>();
+  t.include<tally_test>();
   t.include<content_test>();
+  t.include<event_stream_test>();
   t.run_test_cases();
   return 0;
 }
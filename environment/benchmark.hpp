@@ -0,0 +1,160 @@
+#ifndef flick_benchmark
+#define flick_benchmark
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+namespace flick {
+  struct benchmark_result
+  // Timing of one hot path. Seconds and items, which are the calls,
+  // packages or other units of work, are per repetition.
+  {
+    std::string name;
+    size_t n_warmup{0};
+    size_t n_repetitions{0};
+    std::string item_unit;
+    std::vector<double> seconds;
+    std::vector<double> items;
+    double mean() const {
+      double s = 0;
+      for (double t : seconds)
+	s += t;
+      return s/seconds.size();
+    }
+    double standard_deviation() const {
+      if (seconds.size() < 2)
+	return 0;
+      double m = mean();
+      double s = 0;
+      for (double t : seconds)
+	s += (t-m)*(t-m);
+      return std::sqrt(s/(seconds.size()-1));
+    }
+    double median() const {
+      std::vector<double> s = seconds;
+      std::sort(s.begin(), s.end());
+      size_t n = s.size();
+      if (n % 2 == 1)
+	return s[n/2];
+      return (s[n/2-1] + s[n/2])/2;
+    }
+    double min() const {
+      return *std::min_element(seconds.begin(), seconds.end());
+    }
+    double max() const {
+      return *std::max_element(seconds.begin(), seconds.end());
+    }
+    double items_per_repetition() const {
+      double n = 0;
+      for (double i : items)
+	n += i;
+      return n/items.size();
+    }
+    double items_per_second() const {
+      double t = 0;
+      for (double s : seconds)
+	t += s;
+      return items_per_repetition()*seconds.size()/t;
+    }
+  };
+
+  class benchmark
+  // Runs each hot path a few times untimed to warm up caches and
+  // lazily built tables, then times a number of repetitions and
+  // writes the statistics as JSON
+  {
+    std::string module_;
+    size_t n_warmup_{2};
+    size_t n_repetitions_{10};
+    std::vector<benchmark_result> results_;
+    volatile double sink_{0};
+  public:
+    benchmark(const std::string& module) : module_{module} {
+    }
+    void repetitions(size_t n_warmup, size_t n_repetitions) {
+      if (n_repetitions < 1)
+	throw std::runtime_error("benchmark repetitions");
+      n_warmup_ = n_warmup;
+      n_repetitions_ = n_repetitions;
+    }
+    template<class Function>
+    void run(const std::string& name, Function f,
+	     double items_per_repetition = 1,
+	     const std::string& item_unit = "calls")
+    // Times f(), which should return a value depending on its work so
+    // that it is not optimized away
+    {
+      run_counted(name, [&]() {
+	sink_ = sink_ + f();
+	return items_per_repetition;
+      }, item_unit);
+    }
+    template<class Function>
+    void run_counted(const std::string& name, Function f,
+		     const std::string& item_unit)
+    // Times f(), which returns the number of items it has done, for
+    // work that varies between repetitions
+    {
+      benchmark_result r{name, n_warmup_, n_repetitions_, item_unit, {}, {}};
+      for (size_t i=0; i<n_warmup_; ++i)
+	sink_ = sink_ + f();
+      for (size_t i=0; i<n_repetitions_; ++i) {
+	auto t0 = std::chrono::steady_clock::now();
+	double n = f();
+	std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+	r.seconds.push_back(t.count());
+	r.items.push_back(n);
+      }
+      results_.push_back(r);
+      std::cerr << module_ << " " << name << ": " << r.median()
+		<< " s" << std::endl;
+    }
+    const std::vector<benchmark_result>& results() const {
+      return results_;
+    }
+    friend std::ostream& operator<<(std::ostream &os, const benchmark& b) {
+      const char* compiler = std::getenv("FLICK_COMPILER");
+      os << std::setprecision(9)
+	 << "{\"module\": \"" << b.module_ << "\",\n"
+	 << " \"date\": \"" << date() << "\",\n"
+	 << " \"compiler\": \"" << (compiler ? compiler : "") << "\",\n"
+	 << " \"benchmarks\": [";
+      for (size_t i=0; i<b.results_.size(); ++i) {
+	const benchmark_result& r = b.results_[i];
+	os << (i == 0 ? "\n" : ",\n")
+	   << "  {\"name\": \"" << r.name << "\", "
+	   << "\"warmup\": " << r.n_warmup << ", "
+	   << "\"repetitions\": " << r.n_repetitions << ",\n"
+	   << "   \"item_unit\": \"" << r.item_unit << "\", "
+	   << "\"items_per_repetition\": " << r.items_per_repetition() << ", "
+	   << "\"items_per_second\": " << r.items_per_second() << ",\n"
+	   << "   \"seconds\": {\"mean\": " << r.mean()
+	   << ", \"median\": " << r.median()
+	   << ", \"min\": " << r.min()
+	   << ", \"max\": " << r.max()
+	   << ", \"standard_deviation\": " << r.standard_deviation() << "}}";
+      }
+      os << "\n ]}" << std::setprecision(6);
+      return os;
+    }
+  private:
+    static std::string date() {
+      std::time_t t = std::time(nullptr);
+      char s[32];
+      std::strftime(s, sizeof(s), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&t));
+      return s;
+    }
+  };
+}
+
+#endif
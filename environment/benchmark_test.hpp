@@ -0,0 +1,26 @@
+#include "benchmark.hpp"
+
+namespace flick {
+  begin_test_case(benchmark_test) {
+    benchmark b("environment");
+    b.repetitions(1,3);
+    size_t n_calls = 0;
+    b.run("sum", [&]() {
+      n_calls++;
+      double s = 0;
+      for (size_t i=0; i<1000; ++i)
+	s += i;
+      return s;
+    }, 1000);
+    check(n_calls == 4);
+    const benchmark_result& r = b.results().at(0);
+    check(r.seconds.size() == 3);
+    check(r.min() <= r.median() && r.median() <= r.max());
+    check_close(r.items_per_repetition(), 1000);
+    check(r.items_per_second() > 0);
+    std::stringstream ss;
+    ss << b;
+    check(ss.str().find("\"name\": \"sum\"") != std::string::npos);
+    check_throw(b.repetitions(1,0));
+  } end_test_case()
+}
@@ -6,6 +6,8 @@
 #include <iomanip>
 #include <vector>
 #include <filesystem>
+#include <stdexcept>
+#include <type_traits>
 
 namespace flick {
   std::string path() {
@@ -95,6 +97,45 @@ namespace flick {
     ofs << std::setprecision(precision) << t;
     ofs.close();
   }
+
+  template<typename T>
+  void write_binary(std::ostream& os, const T& t)
+  // Raw bytes of plain values, for state that is read back by
+  // read_binary on the same machine, as in checkpoints
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+  }
+  template<typename T>
+  void write_binary(std::ostream& os, const std::vector<T>& v) {
+    write_binary(os, uint64_t{v.size()});
+    if constexpr (std::is_trivially_copyable_v<T>)
+      os.write(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(T));
+    else
+      for (const T& t : v)
+	write_binary(os, t);
+  }
+  template<typename T>
+  void read_binary(std::istream& is, T& t) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    is.read(reinterpret_cast<char*>(&t), sizeof(T));
+    if (!is)
+      throw std::runtime_error("read_binary");
+  }
+  template<typename T>
+  void read_binary(std::istream& is, std::vector<T>& v) {
+    uint64_t n;
+    read_binary(is, n);
+    v.resize(n);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      is.read(reinterpret_cast<char*>(v.data()), n*sizeof(T));
+      if (!is)
+	throw std::runtime_error("read_binary");
+    } else {
+      for (T& t : v)
+	read_binary(is, t);
+    }
+  }
 }
 
 #endif
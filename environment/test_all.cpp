@@ -2,6 +2,7 @@
 #include "configuration_test.hpp"
 #include "input_output_test.hpp"
 #include "search_and_replace_test.hpp"
+#include "benchmark_test.hpp"
 
 int main() {
   using namespace flick;
@@ -11,6 +12,7 @@ int main() {
   t.include<configuration_test_B>();
   t.include<configuration_test_C>();
   t.include<search_and_replace_test>();
+  t.include<benchmark_test>();
   t.run_test_cases();
   return 0;
 } 
@@ -19,6 +19,8 @@ namespace geometry {
     std::vector<element> elements_;
     pose placement_{{0,0,0},no_rotation()};
     double characteristic_size_{1};
+    std::optional<double> bounding_radius_;
+    bool is_half_space_{false};
   public:
     boundary() = default;   
     boundary(std::shared_ptr<surface::base> s,
@@ -32,6 +34,31 @@ namespace geometry {
     double characteristic_size() const {
       return characteristic_size_;
     }
+    boundary& set_bounding_radius(double r)
+    // Radius of a sphere centered at the placement position that
+    // encloses all surfaces of the boundary
+    {
+      bounding_radius_ = r;
+      return *this;
+    }
+    std::optional<double> bounding_radius() const
+    // None for unbounded boundaries, and for boundaries with surfaces
+    // added after the radius was set
+    {
+      return bounding_radius_;
+    }
+    boundary& set_half_space()
+    // The boundary is a single plane with the volume below it
+    {
+      is_half_space_ = true;
+      return *this;
+    }
+    bool is_half_space() const
+    // True for half spaces below a horizontal plane at the placement
+    // height
+    {
+      return is_half_space_ && placement_.z_direction().z() > 1-1e-12;
+    }
     boundary& add(std::shared_ptr<surface::base> s,
 		  const pose& placement=pose{},
 		  bool inside_out=false) {
@@ -40,6 +67,8 @@ namespace geometry {
       e.surface_ptr = s;
       e.inside_out = inside_out;
       elements_.emplace_back(e);
+      bounding_radius_.reset();
+      is_half_space_ = false;
       return *this;
     }
     double small_step() const {
@@ -72,6 +101,34 @@ namespace geometry {
       }
       return std::optional<pose>{};
     }
+    double distance_from(const vector& position) const
+    // Lower bound on the distance from position to the boundary. The
+    // enclosed space is taken as the intersection of the spaces
+    // enclosed by each surface, which is exact for spheres and boxes.
+    {
+      double inside = std::numeric_limits<double>::max();
+      double outside = 0;
+      for (const element& e : elements_) {
+	vector local = rotate(position-e.placement.position(),
+			      inv(e.placement.rotation()));
+	double d = e.surface_ptr->signed_distance(local);
+	if (e.inside_out)
+	  return min_distance_from(position);
+	if (d > 0)
+	  outside = std::max(outside, d);
+	else
+	  inside = std::min(inside, -d);
+      }
+      return outside > 0 ? outside : inside;
+    }
+    boundary& detach()
+    // Replace surfaces shared with copies of this boundary by own
+    // copies, since surfaces keep the state of the last observer
+    {
+      for (size_t i=0; i<elements_.size(); ++i)
+	elements_[i].surface_ptr = elements_[i].surface_ptr->clone();
+      return *this;
+    }
     boundary& move_by(const vector& v) {
       for (size_t i=0; i<elements_.size(); ++i)
 	elements_[i].placement.move_by(v);
@@ -96,6 +153,17 @@ namespace geometry {
       return os;
     }
   private:
+    double min_distance_from(const vector& position) const
+    // Distance to the closest surface
+    {
+      double d = std::numeric_limits<double>::max();
+      for (const element& e : elements_) {
+	vector local = rotate(position-e.placement.position(),
+			      inv(e.placement.rotation()));
+	d = std::min(d, fabs(e.surface_ptr->signed_distance(local)));
+      }
+      return d;
+    }
     pose get_globally_observed_intersection(size_t n) const {
       const pose& p0 = elements_.at(n).surface_ptr->intersection();
       const pose& p1 = global_observer().as_observed_by(elements_.at(n).placement);
@@ -168,6 +236,7 @@ namespace geometry {
       add(s,{{0,-d,0},rotation_to({0,-1,0})});
       add(s,{{d,0,0},rotation_to({1,0,0})});
       add(s,{{-d,0,0},rotation_to({-1,0,0})});
+      set_bounding_radius(d*sqrt(3));
     }
   };
 
@@ -176,6 +245,7 @@ namespace geometry {
     spherical_boundary(double radius) {
       set_characteristic_size(radius);
       add(make_surface<surface::sphere>(radius));
+      set_bounding_radius(radius);
     }
   };
 
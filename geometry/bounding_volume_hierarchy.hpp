@@ -0,0 +1,173 @@
+#ifndef flick_bounding_volume_hierarchy
+#define flick_bounding_volume_hierarchy
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include "../numeric/pose.hpp"
+
+namespace flick {
+namespace geometry {
+  struct bounding_sphere {
+    vector center;
+    double radius;
+  };
+
+  class bounding_volume_hierarchy
+  // Binary tree of bounding spheres over numbered objects. The
+  // closest object along an observer's z-axis is found by visiting
+  // only nodes that the axis enters before the closest intersection
+  // found so far.
+  {
+    struct node {
+      bounding_sphere bound;
+      size_t begin;
+      size_t end;
+      size_t left{0};
+      size_t right{0};
+    };
+    std::vector<node> nodes_;
+    std::vector<size_t> numbers_;
+    std::vector<bounding_sphere> spheres_;
+    static constexpr size_t leaf_size_{2};
+  public:
+    bounding_volume_hierarchy() = default;
+    bounding_volume_hierarchy(const std::vector<bounding_sphere>& spheres,
+			      const std::vector<size_t>& numbers)
+      : numbers_{numbers}, spheres_{spheres} {
+      if (spheres.size() != numbers.size())
+	throw std::runtime_error("bounding_volume_hierarchy");
+      if (!spheres_.empty())
+	build(0, spheres_.size());
+    }
+    size_t size() const {
+      return numbers_.size();
+    }
+    template<class Distance>
+    std::optional<size_t> closest(const pose& observer, Distance distance) const
+    // Number of the closest object, where distance(number) returns the
+    // optional distance from observer to the object. Ties go to the
+    // lowest number.
+    {
+      std::optional<size_t> n_min;
+      double d_min = std::numeric_limits<double>::max();
+      if (!nodes_.empty())
+	visit(0, observer, distance, n_min, d_min);
+      return n_min;
+    }
+  private:
+    size_t build(size_t begin, size_t end) {
+      size_t i_node = nodes_.size();
+      nodes_.push_back({enclosing(begin, end), begin, end});
+      if (end-begin > leaf_size_) {
+	size_t axis = widest_axis(begin, end);
+	size_t middle = begin + (end-begin)/2;
+	std::vector<size_t> order(end-begin);
+	for (size_t i=0; i<order.size(); ++i)
+	  order[i] = begin+i;
+	std::nth_element(order.begin(), order.begin()+(middle-begin), order.end(),
+			 [&](size_t a, size_t b) {
+			   return coordinate(spheres_[a].center, axis) <
+			     coordinate(spheres_[b].center, axis);
+			 });
+	reorder(begin, order);
+	size_t left = build(begin, middle);
+	size_t right = build(middle, end);
+	nodes_[i_node].left = left;
+	nodes_[i_node].right = right;
+      }
+      return i_node;
+    }
+    template<class Distance>
+    void visit(size_t i_node, const pose& observer, Distance& distance,
+	       std::optional<size_t>& n_min, double& d_min) const {
+      const node& nd = nodes_[i_node];
+      std::optional<double> t = entry_distance(nd.bound, observer);
+      if (!t.has_value() || *t > d_min)
+	return;
+      if (nd.left == 0) {
+	for (size_t i=nd.begin; i<nd.end; ++i) {
+	  std::optional<double> d = distance(numbers_[i]);
+	  if (d.has_value() && (*d < d_min || (*d == d_min && n_min
+						 && numbers_[i] < *n_min))) {
+	    d_min = *d;
+	    n_min = numbers_[i];
+	  }
+	}
+	return;
+      }
+      std::optional<double> t_left = entry_distance(nodes_[nd.left].bound, observer);
+      std::optional<double> t_right = entry_distance(nodes_[nd.right].bound, observer);
+      if (t_right.has_value() && (!t_left.has_value() || *t_right < *t_left)) {
+	visit(nd.right, observer, distance, n_min, d_min);
+	visit(nd.left, observer, distance, n_min, d_min);
+      } else {
+	visit(nd.left, observer, distance, n_min, d_min);
+	visit(nd.right, observer, distance, n_min, d_min);
+      }
+    }
+    static std::optional<double> entry_distance(const bounding_sphere& s,
+						const pose& observer)
+    // Distance along observer's z-axis to where it enters the sphere,
+    // zero if observer is inside
+    {
+      vector oc = s.center - observer.position();
+      double t_closest = dot(oc, observer.z_direction());
+      double d2 = dot(oc,oc) - t_closest*t_closest;
+      double r2 = s.radius*s.radius;
+      if (d2 > r2)
+	return std::nullopt;
+      double half_chord = sqrt(r2-d2);
+      if (t_closest + half_chord < 0)
+	return std::nullopt;
+      return std::max(t_closest - half_chord, 0.0);
+    }
+    bounding_sphere enclosing(size_t begin, size_t end) const {
+      vector c{0,0,0};
+      for (size_t i=begin; i<end; ++i)
+	c = c + spheres_[i].center;
+      c = c/static_cast<double>(end-begin);
+      double r = 0;
+      for (size_t i=begin; i<end; ++i)
+	r = std::max(r, norm(spheres_[i].center-c) + spheres_[i].radius);
+      return {c, r*(1+1e-9)};
+    }
+    size_t widest_axis(size_t begin, size_t end) const {
+      size_t axis = 0;
+      double widest = -1;
+      for (size_t a=0; a<3; ++a) {
+	double low = std::numeric_limits<double>::max();
+	double high = -low;
+	for (size_t i=begin; i<end; ++i) {
+	  low = std::min(low, coordinate(spheres_[i].center, a));
+	  high = std::max(high, coordinate(spheres_[i].center, a));
+	}
+	if (high-low > widest) {
+	  widest = high-low;
+	  axis = a;
+	}
+      }
+      return axis;
+    }
+    void reorder(size_t begin, const std::vector<size_t>& order) {
+      std::vector<bounding_sphere> s(order.size());
+      std::vector<size_t> n(order.size());
+      for (size_t i=0; i<order.size(); ++i) {
+	s[i] = spheres_[order[i]];
+	n[i] = numbers_[order[i]];
+      }
+      std::copy(s.begin(), s.end(), spheres_.begin()+begin);
+      std::copy(n.begin(), n.end(), numbers_.begin()+begin);
+    }
+    static double coordinate(const vector& v, size_t axis) {
+      if (axis == 0)
+	return v.x();
+      if (axis == 1)
+	return v.y();
+      return v.z();
+    }
+  };
+}
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "bounding_volume_hierarchy.hpp"
+#include "../numeric/direction_generator.hpp"
+
+namespace flick {
+namespace geometry {
+  begin_test_case(bounding_volume_hierarchy_test) {
+    // Closest spheres should be those found by a linear scan, after
+    // intersection tests with a small share of the spheres
+    auto lookups = [&](size_t m) {
+      std::vector<bounding_sphere> spheres;
+      std::vector<size_t> numbers;
+      double step = 180.0/m;
+      for (size_t i=0; i<m*m*m; ++i) {
+	spheres.push_back({vector{-90+step*(i%m+0.5), -90+step*(i/m%m+0.5),
+	      -90+step*(i/m/m+0.5)}, 0.3*step});
+	numbers.push_back(i);
+      }
+      bounding_volume_hierarchy h(spheres, numbers);
+      uniform_random ur(1);
+      direction_generator dg(ur);
+      size_t n_tests = 0;
+      size_t n_lookups = 500;
+      for (size_t k=0; k<n_lookups; ++k) {
+	pose o{vector{ur(-90,90), ur(-90,90), ur(-90,90)}, dg.isotropic()};
+	auto distance = [&](size_t i) -> std::optional<double> {
+	  vector oc = spheres[i].center - o.position();
+	  double t = dot(oc, o.z_direction());
+	  double d2 = dot(oc,oc) - t*t;
+	  double r2 = spheres[i].radius*spheres[i].radius;
+	  if (d2 > r2 || t + sqrt(r2-d2) < 0)
+	    return std::nullopt;
+	  return t - sqrt(r2-d2) > 0 ? t - sqrt(r2-d2) : t + sqrt(r2-d2);
+	};
+	std::optional<size_t> n_scanned;
+	double d_min = std::numeric_limits<double>::max();
+	for (size_t i=0; i<spheres.size(); ++i) {
+	  std::optional<double> d = distance(i);
+	  if (d.has_value() && *d < d_min) {
+	    d_min = *d;
+	    n_scanned = i;
+	  }
+	}
+	auto counted = [&](size_t i) {
+	  n_tests++;
+	  return distance(i);
+	};
+	check(h.closest(o, counted) == n_scanned);
+      }
+      return double(n_tests)/n_lookups;
+    };
+    double tests_8 = lookups(2);
+    double tests_512 = lookups(8);
+    check(tests_512 < 0.05*512);
+    check(tests_512 < 4*tests_8);
+    check_throw(bounding_volume_hierarchy({{vector{0,0,0}, 1}}, {}));
+  } end_test_case()
+}
+}
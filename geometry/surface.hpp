@@ -32,6 +32,8 @@ namespace geometry {
 	return encloses_observer_;
       }
       virtual void set_observer(const pose& o) = 0;
+      virtual double signed_distance(const vector& position) const = 0;
+      virtual std::shared_ptr<base> clone() const = 0;
     protected:
       pose observer_;
       bool has_intersection_{false};
@@ -43,6 +45,9 @@ namespace geometry {
     // xy-plane at z=0
     {
     public:
+      std::shared_ptr<base> clone() const override {
+	return std::make_shared<plane>(*this);
+      }
       void set_observer(const pose& o) {
 	observer_ = o;
 	unit_vector normal = {0,0,1};
@@ -57,6 +62,11 @@ namespace geometry {
 	else
 	  encloses_observer_ = false;
       }
+      double signed_distance(const vector& position) const
+      // Negative below the plane
+      {
+	return position.z();
+      }
     };
     
     class sphere : public base
@@ -66,6 +76,9 @@ namespace geometry {
       double r_{1};
     public:
       sphere(double r) : r_{r} {}
+      std::shared_ptr<base> clone() const override {
+	return std::make_shared<sphere>(*this);
+      }
       void set_observer(const pose& o) {
 	observer_ = o;
 	const unit_vector &l = o.z_direction();
@@ -95,6 +108,11 @@ namespace geometry {
 	  intersection_.rotate_to(normalize(intersection_.position()));
 	}
       }
+      double signed_distance(const vector& position) const
+      // Negative inside the sphere
+      {
+	return position.r()-r_;
+      }
     };
   
   }
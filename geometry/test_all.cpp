@@ -1,6 +1,7 @@
 #include "../environment/unit_test.hpp"
 #include "boundary_test.hpp"
 #include "volume_test.hpp"
+#include "bounding_volume_hierarchy_test.hpp"
 
 int main() {
   using namespace flick;
@@ -9,6 +10,9 @@ int main() {
   t.include<boundary_test>();
   t.include<volume_test_A>();
   t.include<volume_test_B>();
+  t.include<volume_test_C>();
+  t.include<volume_test_D>();
+  t.include<bounding_volume_hierarchy_test>();
   t.run_test_cases();
   return 0;
 }
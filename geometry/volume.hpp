@@ -2,7 +2,9 @@
 #define flick_volume
 
 #include <stdexcept>
+#include <unordered_map>
 #include "boundary.hpp"
+#include "bounding_volume_hierarchy.hpp"
 
 namespace flick {
 namespace geometry {
@@ -17,10 +19,14 @@ namespace geometry {
     boundary boundary_;
     volume<T>* outer_volume_; 
     std::vector<volume<T>> inner_volumes_;
+    bounding_volume_hierarchy hierarchy_;
+    std::vector<size_t> unbounded_inner_volumes_;
+    bool is_indexed_{false};
   public:
     void clear() {
       inner_volumes_.clear();
       inner_volumes_.shrink_to_fit();
+      is_indexed_ = false;
     }
     std::string name() const {
       return name_;
@@ -31,6 +37,9 @@ namespace geometry {
     pose placement() const { 
       return boundary_.placement();
     }
+    bool is_half_space() const {
+      return boundary_.is_half_space();
+    }
     size_t n_inner_volumes() const {
       return inner_volumes_.size();
     }
@@ -51,8 +60,11 @@ namespace geometry {
     }
     std::optional<size_t> closest_inner_volume(const pose& observer) const
     // Closest inner volume number (if any) intersecting observer's
-    // z-axis.
+    // z-axis. Bounded inner volumes are searched through the bounding
+    // volume hierarchy when volumes are indexed.
     {
+      if (is_indexed_)
+	return indexed_closest_inner_volume(observer);
       std::optional<size_t> n{};
       double d_min = std::numeric_limits<double>::max();
       for (size_t i=0; i < inner_volumes_.size(); ++i) {
@@ -79,6 +91,20 @@ namespace geometry {
       }
       return boundary_.intersection(observer);      
     }
+    double distance_to_walls(const vector& position) const
+    // Radius of a sphere around position, inside the volume, that no
+    // wall of the volume or of its inner volumes enters
+    {
+      double d = boundary_.distance_from(position);
+      for (const volume& v : inner_volumes_) {
+	std::optional<double> r = v.boundary_.bounding_radius();
+	if (r.has_value()
+	    && norm(position-v.boundary_.placement().position()) - *r >= d)
+	  continue;
+	d = std::min(d, v.boundary_.distance_from(position));
+      }
+      return d;
+    }
     uniform_intersections get_uniform_intersections(size_t n_reflections) const{
       double cs = boundary_.characteristic_size();
       return uniform_intersections(boundary_, n_reflections,
@@ -91,6 +117,7 @@ namespace geometry {
     volume& insert(const volume& v) 
     {
       inner_volumes_.emplace_back(v);
+      is_indexed_ = false;
       return *this;
     }    
     T& content() {
@@ -100,14 +127,26 @@ namespace geometry {
       return content_;
     } 
     volume& move_by(const vector& v) {
+      is_indexed_ = false;
       boundary_.move_by(v);
       for (size_t i=0; i<inner_volumes_.size(); ++i) {
 	inner_volumes_[i].move_by(v);
       }
       return *this;
     }
+    volume& detach()
+    // Give volume and all inner volumes boundaries of their own. See
+    // boundary detach.
+    {
+      boundary_.detach();
+      for (size_t i=0; i<inner_volumes_.size(); ++i) {
+	inner_volumes_[i].detach();
+      }
+      return *this;
+    }
     volume& rotate_by(const quaternion& rotation,
 		      const vector& rotation_center={0,0,0}) {
+      is_indexed_ = false;
       boundary_.rotate_by(rotation, rotation_center);
       for (size_t i=0; i<inner_volumes_.size(); ++i) {
 	inner_volumes_[i].rotate_by(rotation, rotation_center);
@@ -123,6 +162,28 @@ namespace geometry {
 	inner_volumes_[i].set_outer_volume_pointers();
       }      
     }
+    void index_inner_volumes()
+    // Build bounding volume hierarchies over inner volumes in the
+    // whole tree. Moving, rotating or inserting volumes drops the
+    // index of the changed volumes.
+    {
+      std::vector<bounding_sphere> spheres;
+      std::vector<size_t> numbers;
+      unbounded_inner_volumes_.clear();
+      for (size_t i=0; i < inner_volumes_.size(); ++i) {
+	const boundary& b = inner_volumes_[i].boundary_;
+	std::optional<double> r = b.bounding_radius();
+	if (r.has_value()) {
+	  spheres.push_back({b.placement().position(), *r + b.small_step()});
+	  numbers.push_back(i);
+	} else {
+	  unbounded_inner_volumes_.push_back(i);
+	}
+	inner_volumes_[i].index_inner_volumes();
+      }
+      hierarchy_ = bounding_volume_hierarchy(spheres, numbers);
+      is_indexed_ = true;
+    }
     friend std::ostream& operator<<(std::ostream &os, const volume<T>& v) {
       os << "(0,0) ";
       v.write(os);
@@ -133,6 +194,26 @@ namespace geometry {
       boundary_{b}, name_{name}, outer_volume_{NULL} {
     }
   private:
+    std::optional<size_t> indexed_closest_inner_volume(const pose& observer) const {
+      auto distance = [&](size_t i) -> std::optional<double> {
+	std::optional<pose> p = inner_volumes_[i].boundary_.intersection(observer);
+	if (p.has_value())
+	  return norm((*p).position()-observer.position());
+	return std::nullopt;
+      };
+      std::optional<size_t> n = hierarchy_.closest(observer, distance);
+      std::optional<double> d_min;
+      if (n.has_value())
+	d_min = distance(*n);
+      for (size_t i : unbounded_inner_volumes_) {
+	std::optional<double> d = distance(i);
+	if (d.has_value() && (!d_min || *d < *d_min || (*d == *d_min && i < *n))) {
+	  d_min = d;
+	  n = i;
+	}
+      }
+      return n;
+    }
     void write(std::ostream& os=std::cout, size_t tree_depth=0) const {
       os << name_ << ", " << inner_volumes_.size() << ", " << boundary_;
       os << '\n';
@@ -163,17 +244,28 @@ namespace geometry {
   class semi_infinite_box : public volume<T> {
   public:
     semi_infinite_box() :
-      volume<T>(boundary{make_surface<surface::plane>()},"semi_infinite_box") {
+      volume<T>(boundary{make_surface<surface::plane>()}.set_half_space(),
+		"semi_infinite_box") {
     }
   };
  
   template<class T>
-  class navigator {
+  class navigator
+  // Keeps track of the current volume in a volume tree. The tree is
+  // indexed by name and by inner volume bounding spheres when the
+  // navigator is made, and should not change shape afterwards.
+  {
+    using name_index = std::unordered_map<std::string, volume<T>*>;
     volume<T>* v_;
+    std::shared_ptr<const name_index> names_;
   public:
     navigator()=default;
     navigator(volume<T> &v) : v_{&v} {
       v_->set_outer_volume_pointers();
+      v_->index_inner_volumes();
+      auto names = std::make_shared<name_index>();
+      add_names(v, *names);
+      names_ = names;
     }        
     volume<T>& go_to_outermost_volume() {
       while(v_->has_outer_volume())
@@ -192,23 +284,22 @@ namespace geometry {
       v_ = &v;
       return *v_;
     }
-    volume<T>& go_to(const std::string& name) {
-      if (v_->name()==name)
-	return *v_;
-      for (size_t i=0; i < v_->n_inner_volumes(); ++i) {
-	go_inward(i);
-	go_to(name);
-      }
+    volume<T>& go_to(const std::string& name)
+    // Stays in current volume if name is not found
+    {
+      auto it = names_->find(name);
+      if (it != names_->end())
+	v_ = it->second;
       return *v_;
     }
-    volume<T>& find(const std::string& name) {
-      go_to_outermost_volume();
-      volume<T>* v0 = v_;
-      volume<T>& v_found = go_to(name);
-      v_ = v0;
-      if (v_found.name()!=name)
+    volume<T>& find(const std::string& name) const
+    // The first volume with this name, searching depth first from the
+    // outermost volume
+    {
+      auto it = names_->find(name);
+      if (it == names_->end())
 	throw  std::runtime_error("volume named \""+name+"\" not found");
-      return v_found;
+      return *it->second;
     }
     volume<T>& current_volume() const {
       return *v_;
@@ -230,6 +321,12 @@ namespace geometry {
 	return true;
       return false;
     }
+  private:
+    static void add_names(volume<T>& v, name_index& names) {
+      names.emplace(v.name(), &v);
+      for (size_t i=0; i < v.n_inner_volumes(); ++i)
+	add_names(v.inner_volume(i), names);
+    }
   };
   
 }
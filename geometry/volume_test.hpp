@@ -93,5 +93,70 @@ namespace geometry {
     check(nav.find("atmosphere").name()=="atmosphere","find error");
     check_throw(nav.find("wrongname"));
   } end_test_case()
+
+  begin_test_case(volume_test_C) {
+    // Inner volumes found through the bounding volume hierarchy should
+    // be the same as by looping over all of them
+    class content {};
+    sphere<content> container{100};
+    for (size_t i=0; i<10; ++i) {
+      for (size_t j=0; j<10; ++j) {
+	for (size_t k=0; k<10; ++k) {
+	  vector position{10.0*i-45, 10.0*j-45, 10.0*k-45};
+	  if ((i+j+k)%2 == 0) {
+	    sphere<content> s{2};
+	    s.move_by(position);
+	    container.insert(s);
+	  } else {
+	    cube<content> c{3};
+	    c.move_by(position);
+	    container.insert(c);
+	  }
+	}
+      }
+    }
+    container.name("container");
+    container.inner_volume(123).name("inner");
+    sphere<content> unindexed = container;
+    navigator<content> nav(container);
+    check(nav.find("inner").placement().position().x()==container.
+	  inner_volume(123).placement().position().x());
+    direction_generator dg;
+    uniform_random ur;
+    std::vector<pose> observers;
+    for (size_t i=0; i<500; ++i) {
+      vector position{ur(-60,60), ur(-60,60), ur(-60,60)};
+      observers.push_back(pose{position, dg.isotropic()});
+    }
+    std::vector<std::optional<size_t>> n_indexed;
+    for (auto& o : observers)
+      n_indexed.push_back(container.closest_inner_volume(o));
+    std::vector<std::optional<size_t>> n_unindexed;
+    for (auto& o : observers)
+      n_unindexed.push_back(unindexed.closest_inner_volume(o));
+    check(n_indexed == n_unindexed);
+  } end_test_case()
+
+  begin_test_case(volume_test_D) {
+    // Spheres free of walls should reach the nearest wall, and no
+    // wall should be closer along any ray
+    class content {};
+    sphere<content> container{10};
+    cube<content> c{2};
+    c.move_by({5,0,0});
+    container.insert(c);
+    check_close(container.distance_to_walls({0,0,0}),4);
+    check_close(container.distance_to_walls({0,0,-8}),2);
+    check_close(container.distance_to_walls({5,0,0.5}),0.5);
+    direction_generator dg;
+    uniform_random ur;
+    for (size_t i=0; i<200; ++i) {
+      pose o{vector{ur(-6,6), ur(-6,6), ur(-6,6)}, dg.isotropic()};
+      std::optional<pose> p = container.intersection(o);
+      if (p.has_value())
+	check(norm(p->position()-o.position())
+	      >= container.distance_to_walls(o.position())*(1-1e-12));
+    }
+  } end_test_case()
 }
 }
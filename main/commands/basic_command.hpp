@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 #include "../../environment/input_output.hpp"
 #include "../../environment/exception.hpp"
 #include "../../numeric/std_operators.hpp"
@@ -13,6 +14,7 @@ namespace flick {
       std::string name_;
       std::vector<std::string> options_;
       std::vector<std::string> arguments_;
+      std::vector<std::string> named_options_;
     public:
       basic_command(std::string name) : name_{name}{}
       std::string a(size_t n) const {
@@ -27,8 +29,27 @@ namespace flick {
       }
       void set_arguments(const std::vector<std::string>& input) {
 	options_ = get_options(input);
+	named_options_.clear();
+	for (const std::string& o : input)
+	  if (o.substr(0,2) == "--")
+	    named_options_.push_back(o);
 	arguments_ = get_arguments(input);
       }
+      bool has_option(const std::string& name) const
+      // Options given without value, like --name
+      {
+	return std::find(options_.begin(), options_.end(), "--"+name)
+	  != options_.end();
+      }
+      std::string option(const std::string& name) const
+      // Value of options given as --name=value, or empty
+      {
+	std::string prefix = "--"+name+"=";
+	for (const std::string& o : named_options_)
+	  if (o.substr(0,prefix.size()) == prefix)
+	    return o.substr(prefix.size());
+	return "";
+      }
       size_t size() {
 	return arguments_.size();
       }
@@ -0,0 +1,34 @@
+#ifndef flick_command_merge
+#define flick_command_merge
+
+#include "basic_command.hpp"
+#include "../../model/shard.hpp"
+
+namespace flick {
+  namespace command {
+    class merge : public basic_command {
+    public:
+      merge() : basic_command("merge") {};
+      void run() {
+	if (size() < 2) {
+	  error();
+	  return;
+	}
+	std::vector<model::shard> shards;
+	for (size_t i=1; i<size(); ++i)
+	  shards.push_back(model::shard::read(a(i)));
+	model::distribution d = model::merge(shards);
+	std::cout << d.mean() << "\n\n"
+		  << "label " << shards[0].label() << '\n'
+		  << "confidence_95 " << d.accuracy()*d.mean() << '\n'
+		  << "relative_accuracy " << d.accuracy() << '\n'
+		  << "shards " << shards.size() << '\n'
+		  << "of_shards " << shards[0].count() << '\n'
+		  << "packages " << d.total_packages() << '\n'
+		  << "batches " << d.n_batches();
+      }
+    };
+  }
+}
+
+#endif
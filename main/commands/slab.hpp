@@ -0,0 +1,71 @@
+#ifndef flick_command_slab
+#define flick_command_slab
+
+#include "basic_command.hpp"
+#include "../../model/single_layer_slab.hpp"
+#include "../../material/henyey_greenstein.hpp"
+
+namespace flick {
+  namespace command {
+    class slab : public basic_command {
+    public:
+      slab() : basic_command("slab") {};
+      void run() {
+	std::string shard = option("shard");
+	std::string shards = option("shards");
+	bool is_sharded = !shard.empty() || !shards.empty();
+	if (size() != 9 || (is_sharded && (shard.empty() || shards.empty()))) {
+	  error();
+	  return;
+	}
+	std::string quantity = a(1);
+	model::single_layer_slab s{thickness{std::stod(a(2))}};
+	s.fill<material::henyey_greenstein>(absorption_coefficient{std::stod(a(3))},
+					    scattering_coefficient{std::stod(a(4))},
+					    asymmetry_factor{std::stod(a(5))});
+	s.set_bottom(albedo{std::stod(a(6))});
+	s.orient_source(zenith_angle{std::stod(a(7))});
+	s.adjust_accuracy(percentage{std::stod(a(8))});
+	s.set_threads(std::thread::hardware_concurrency());
+	s.collect_statistics(has_option("statistics"));
+	if (!option("seed").empty())
+	  s.set_seed(std::stoull(option("seed")));
+	if (!option("quasi_random").empty())
+	  s.use_quasi_random(std::stoull(option("quasi_random")));
+	if (!option("checkpoint").empty()) {
+	  std::string seconds = option("checkpoint_seconds");
+	  s.set_checkpoint(option("checkpoint"), 1,
+			   seconds.empty() ? 600 : std::stod(seconds));
+	}
+	if (is_sharded)
+	  s.set_shard(std::stoull(shard), std::stoull(shards));
+	if (quantity == "reflectance")
+	  std::cout << s.hemispherical_reflectance();
+	else if (quantity == "transmittance")
+	  std::cout << s.hemispherical_transmittance();
+	else if (quantity == "all" && !is_sharded) {
+	  s.add_hemispherical_reflectance();
+	  s.add_hemispherical_transmittance();
+	  std::vector<double> e = s.estimate_all();
+	  std::cout << e[0] << " " << e[1];
+	} else {
+	  error();
+	  return;
+	}
+	if (is_sharded) {
+	  std::string label = a(0);
+	  for (size_t i=1; i<size(); ++i)
+	    label += " "+a(i);
+	  std::string file = option("output");
+	  if (file.empty())
+	    file = "shard_"+shard+".bin";
+	  s.partial_tally(label).write(file);
+	}
+	if (has_option("statistics"))
+	  std::cout << "\n\n" << s.event_statistics();
+      }
+    };
+  }
+}
+
+#endif
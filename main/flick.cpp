@@ -12,6 +12,8 @@
 #include "commands/delta_fit.hpp"
 #include "commands/text.hpp"
 #include "commands/accurt.hpp"
+#include "commands/slab.hpp"
+#include "commands/merge.hpp"
 
 
 int main(int argc, char* argv[]) {
@@ -29,6 +31,8 @@ int main(int argc, char* argv[]) {
     if (run<command::delta_fit>(a)) return 0;
     if (run<command::text>(a)) return 0;
     if (run<command::accurt>(a)) return 0;
+    if (run<command::slab>(a)) return 0;
+    if (run<command::merge>(a)) return 0;
     throw std::runtime_error("cannot recognize command, try\n\n flick help\n\n");
   }
   catch (const flick::exception& e) {
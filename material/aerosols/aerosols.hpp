@@ -45,6 +45,9 @@ namespace material {
       asymmetry_factor_ = read<pl_table>(path+name+"_asymmetry.txt");
       make_iop_profiles();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<aerosols>(*this);
+    }
     void set_wavelength(double wl) override {
       base::set_wavelength(wl);
       make_iop_profiles();
@@ -60,6 +60,9 @@ optimized for TOA radiation.)");
       add_snow();
       auto_update_iops(true);
     }
+    std::shared_ptr<base> clone() const override {
+      return clone_as<atmosphere>();
+    }
     static stdvector height_grid(const basic_configuration& c) {
       double epsilon = 1e-4; // m
       stdvector h = atmospheric_state(c.get<size_t>("n_heights")).height_grid();
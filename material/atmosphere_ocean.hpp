@@ -24,6 +24,9 @@ namespace material {
       set_range<atmosphere>(n_oce, n_oce+n_atm-1);
       auto_update_iops(true);
     }
+    std::shared_ptr<base> clone() const override {
+      return clone_as<atmosphere_ocean>();
+    }
     static stdvector height_grid(const basic_configuration& c) {
       stdvector a = ocean::height_grid(c);
       stdvector b = atmosphere::height_grid(c);
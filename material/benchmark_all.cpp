@@ -0,0 +1,25 @@
+#include "../environment/benchmark.hpp"
+#include "atmosphere.hpp"
+#include "layered_iops.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("material");
+  material::atmosphere::configuration c;
+  c.set<size_t>("n_angles",50);
+  c.set<size_t>("n_heights",6);
+  auto atm = std::make_shared<material::atmosphere>(c);
+  layered_iops iops(atm,range(0.1,100e3,8).logspace(),16);
+  std::vector<double> wls = range(400e-9,700e-9,10).linspace();
+  b.repetitions(1,5);
+  b.run("layered_iops::set_wavelength", [&]() {
+    double s = 0;
+    for (double wl : wls) {
+      iops.set_wavelength(wl);
+      s += iops.scattering_optical_depth()[0];
+    }
+    return s;
+  }, wls.size());
+  std::cout << b << std::endl;
+  return 0;
+}
@@ -8,6 +8,9 @@ namespace material {
   class fournier_forand : public monocrome_iop {
   public:
     using monocrome_iop::monocrome_iop;
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<fournier_forand>(*this);
+    }
     mueller mueller_matrix(const unit_vector& scattering_direction) const {
       mueller m;
       double theta = angle(scattering_direction);
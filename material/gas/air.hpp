@@ -18,6 +18,7 @@ namespace material {
   public:
     basic_air(const atmospheric_state& atm)
       : atm_{atm} {}
+    std::shared_ptr<base> clone() const override = 0;
     mueller mueller_matrix(const unit_vector& scattering_direction) const override {
       return rayleigh_mueller(z_profile<pe_function>::angle(scattering_direction),0.0279);
     }
@@ -70,6 +71,9 @@ namespace material {
       }
       make_iop_profiles();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<hitran_air>(*this);
+    }
   private:
     double absorption_coefficient(size_t gas_number, double height) override {
       double h = height;
@@ -112,6 +116,9 @@ namespace material {
       }
       make_iop_profiles();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<smooth_air>(*this);
+    }
   private:
     double absorption_coefficient(size_t gas_number, double height) override {
       double wl = wavelength();
@@ -130,11 +137,17 @@ namespace material {
   class uv_air : public smooth_air {
   public:
     uv_air(const atmospheric_state& atm) : smooth_air(atm,"uv") {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<uv_air>(*this);
+    }
   };
   
   class uv_vis_air : public smooth_air {
   public:
     uv_vis_air(const atmospheric_state& atm) : smooth_air(atm,"uv_vis") {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<uv_vis_air>(*this);
+    }
   };
 }
 }
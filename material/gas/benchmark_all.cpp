@@ -0,0 +1,19 @@
+#include "../../environment/benchmark.hpp"
+#include "lines.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("gas");
+  lines o2("o2");
+  o2.temperature(296);
+  o2.total_pressure(1013e2);
+  o2.partial_pressure(0.21*1013e2);
+  std::vector<double> wls = range(755e-9,775e-9,1000).linspace();
+  b.repetitions(1,5);
+  b.run("lines::absorption_coefficient", [&]() {
+    std::vector<double> a = o2.absorption_coefficient(wls);
+    return a.at(a.size()/2);
+  }, wls.size());
+  std::cout << b << std::endl;
+  return 0;
+}
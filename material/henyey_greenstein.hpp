@@ -8,6 +8,9 @@ namespace material {
   class henyey_greenstein : public monocrome_iop {
   public:
     using monocrome_iop::monocrome_iop;
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<henyey_greenstein>(*this);
+    }
     mueller mueller_matrix(const unit_vector& scattering_direction) const {
       mueller m;
       double theta = angle(scattering_direction);
@@ -22,6 +25,9 @@ namespace material {
       : henyey_greenstein(flick::absorption_coefficient{0},
 			  flick::scattering_coefficient{scat_coef},
 			  flick::asymmetry_factor{0}) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<white_isotropic>(*this);
+    }
   };
 }
 }
@@ -20,6 +20,9 @@ namespace material {
      absorption_coefficient_.add_constant_extrapolation();
      real_refractive_index_.add_constant_extrapolation();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<pure_ice>(*this);
+    }
     double absorption_coefficient() const {
       return absorption_coefficient_.value(wavelength());
     }
@@ -32,6 +35,9 @@ namespace material {
     double real_refractive_index() const {
       return real_refractive_index_.value(wavelength());
     }
+    bool is_homogeneous() const {
+      return true;
+    }
   };
 }
 }
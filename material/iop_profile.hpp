@@ -33,7 +33,9 @@ namespace flick {
   public:
     basic_iop_profile() = default;
     basic_iop_profile(const Function& vertical_profile)
-      : profile_{vertical_profile} {}
+      : profile_{vertical_profile} {
+      profile_.precompute_integrals();
+    }
     virtual double optical_depth(const pose& start, double distance) const = 0;
     virtual double distance(const pose& start, double optical_depth) const = 0;
     const std::vector<double>& heights() const {
@@ -66,6 +68,7 @@ namespace flick {
       } else {
 	profile_ = integral_conservative_add(profile_, p.profile_, heights);
       }
+      profile_.precompute_integrals();
       if (not std::isfinite(profile_.integral()))
 	throw std::runtime_error("Possibly less than two points in iop_profile");
       return *this;
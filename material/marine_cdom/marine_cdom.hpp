@@ -30,6 +30,9 @@ namespace material {
       a_.add_constant_extrapolation();
 
       
+    }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<marine_cdom>(*this);
     }
     double absorption_coefficient() const {
       const double to_nm = 1e9;
@@ -43,6 +46,9 @@ namespace material {
   template<int n>
   struct listable_marine_cdom : public marine_cdom {
     using marine_cdom::marine_cdom;
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<listable_marine_cdom>(*this);
+    }
   };
 }
 }
@@ -51,6 +51,9 @@ namespace material {
       a_star_bleached_.add_constant_extrapolation();
       b_star_.add_constant_extrapolation();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<marine_particles>(*this);
+    }
     void mass_concentration(double c) {
       mass_concentration_ = c;
     } 
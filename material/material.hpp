@@ -6,6 +6,7 @@
 #include "../numeric/range.hpp"
 #include "../polarization/rayleigh_mueller.hpp"
 #include "../polarization/mueller.hpp"
+#include "../numeric/tabulated_distribution.hpp"
 #include <complex>
 #include <algorithm>
 
@@ -14,6 +15,10 @@ namespace material {
   class base {
     double wavelength_{500e-9};
     flick::pose pose_;
+    mutable tabulated_distribution scattering_mu_;
+    mutable double scattering_mu_wavelength_{0};
+    mutable size_t scattering_mu_layer_{0};
+    mutable bool has_scattering_mu_{false};
   public:
     virtual void set(const pose& p) {
       pose_ = p;
@@ -40,11 +45,46 @@ namespace material {
     }
     virtual double absorption_coefficient() const = 0;
     virtual double scattering_coefficient() const = 0;
+    virtual std::shared_ptr<base> clone() const = 0;
+    // Copy with its own pose and cache state, for use in concurrent
+    // transport. Each concrete material returns its own type.
     virtual mueller mueller_matrix(const unit_vector&
 				   scattering_direction) const {
       mueller m;
       return m.add(0,0,1/(4*constants::pi));
     }
+    virtual bool is_homogeneous() const
+    // True for materials with optical properties that do not change
+    // with position
+    {
+      return false;
+    }
+    virtual size_t phase_function_layer() const
+    // Index of the layer the phase function belongs to, for materials
+    // where it changes with position
+    {
+      return 0;
+    }
+    virtual stdvector profile_heights() const
+    // Height grid of materials with optical properties that change
+    // with height only, and empty for other materials
+    {
+      return {};
+    }
+    const tabulated_distribution& scattering_mu_distribution() const
+    // Distribution of cosine of scattering angle given by the phase
+    // function, tabulated once for each wavelength and layer
+    {
+      size_t layer = phase_function_layer();
+      if (!has_scattering_mu_ || scattering_mu_wavelength_ != wavelength_
+	  || scattering_mu_layer_ != layer) {
+	scattering_mu_ = tabulate_scattering_mu();
+	scattering_mu_wavelength_ = wavelength_;
+	scattering_mu_layer_ = layer;
+	has_scattering_mu_ = true;
+      }
+      return scattering_mu_;
+    }
     virtual double absorption_optical_depth(double distance) const {
       return absorption_coefficient()*distance;
     }
@@ -85,6 +125,41 @@ namespace material {
       double k = absorption_coefficient() * wavelength() / (4*constants::pi); 
       return std::complex<double>{n,k};
     }
+  private:
+    tabulated_distribution tabulate_scattering_mu() const
+    // Points are dense towards forward scattering, down to a micro
+    // radian, to resolve peaked phase functions. Singular values, as
+    // for Fournier-Forand at zero angle, are replaced by their
+    // neighbour.
+    {
+      std::vector<double> angles = hg_importance_sampling(0.9, 2000);
+      std::vector<double> forward = range(1e-6, angles[1], 200).logspace();
+      angles.insert(angles.begin()+1, forward.begin(), forward.end()-1);
+      size_t n_points = angles.size();
+      std::vector<double> mu;
+      std::vector<double> p;
+      double p_max = 0;
+      for (size_t i=n_points; i-- > 0;) {
+	double x = std::clamp<double>(cos(angles[i]),-1,1);
+	if (i == n_points-1)
+	  x = -1;
+	else if (i == 0)
+	  x = 1;
+	if (!mu.empty() && x <= mu.back())
+	  continue;
+	flick::pose sd = pose_;
+	sd.rotate_about_local_y(angles[i]);
+	double v = mueller_matrix(sd.z_direction()).value(0,0);
+	if (!std::isfinite(v))
+	  v = p.empty() ? 0 : p.back();
+	mu.push_back(x);
+	p.push_back(std::max(v, 0.0));
+	p_max = std::max(p.back(), p_max);
+      }
+      for (auto& v : p)
+	v = std::max(v, 1e-12*p_max);
+      return tabulated_distribution(mu,p);
+    }
   };
 
   class phase_function
@@ -151,6 +226,12 @@ namespace material {
 
   class vacuum : public base {
   public:
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<vacuum>(*this);
+    }
+    bool is_homogeneous() const {
+      return true;
+    }
     double absorption_coefficient() const {
       return 0;
     }
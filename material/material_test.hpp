@@ -1,4 +1,23 @@
+#include "henyey_greenstein.hpp"
+
 namespace flick {
   begin_test_case(material_test_A) {   
   } end_test_case()
+
+  begin_test_case(material_test_B) {
+    double g = 0.9;
+    material::henyey_greenstein hg{absorption_coefficient{0},
+      scattering_coefficient{1}, asymmetry_factor{g}};
+    hg.set_direction(unit_vector{1,2});
+    const tabulated_distribution& d = hg.scattering_mu_distribution();
+    size_t n = 100000;
+    double mean_mu = 0;
+    for (size_t i=0; i<n; ++i)
+      mean_mu += d.quantile((i+0.5)/n)/n;
+    check_close(mean_mu,g,0.1_pct);
+    double mu = 0.3;
+    check_close(d.pdf(mu)/(2*constants::pi),
+		flick::henyey_greenstein(g).value(mu),0.1_pct);
+    check(&hg.scattering_mu_distribution() == &d);
+  } end_test_case()
 }
@@ -31,6 +31,9 @@ namespace material {
       : angles_{angles}, heights_{heights} {
       mueller_.resize(heights.size());
     }
+    std::shared_ptr<base> clone() const override {
+      return clone_as<mixture<Function>>();
+    }
     const stdvector& heights() const {
       return heights_;
     }
@@ -87,14 +90,18 @@ namespace material {
       for (size_t i=0; i<mueller_[n].size(); ++i) {
 	size_t row = mueller_[n](i).row;
 	size_t col = mueller_[n](i).col;
-	stdvector x{heights_[n],heights_[n+1]};
-	stdvector y{mueller_[n].value(row,col,cos(theta)),
-	  mueller_[n+1].value(row,col,cos(theta))};
-	Function f{x,y};
-	m.add(row,col,f.value(z_profile<Function>::pose().position().z()));
+	using I = typename Function::interpolation;
+	point low = I::enforce_valid({heights_[n],
+	    mueller_[n].value(row,col,cos(theta))});
+	point high = I::enforce_valid({heights_[n+1],
+	    mueller_[n+1].value(row,col,cos(theta))});
+	m.add(row,col,I{low,high}.y(z_profile<Function>::pose().position().z()));
       }
       return m;
     }
+    size_t phase_function_layer() const override {
+      return s_profile_.low_index_near(z_profile<Function>::pose().position().z());
+    }
     void set_wavelength(double wl) override {
       for (auto const& [key, material] : materials_) {
 	material->set_wavelength(wl);
@@ -121,6 +128,18 @@ namespace material {
       }
       return ids;
     }
+  protected:
+    template<class Mixture>
+    std::shared_ptr<base> clone_as() const
+    // Copy of this as the derived Mixture, with its own copies of the
+    // mixed materials
+    {
+      auto c = std::make_shared<Mixture>(static_cast<const Mixture&>(*this));
+      mixture<Function>& m = *c;
+      for (auto& [name, material] : m.materials_)
+	material = material->clone();
+      return c;
+    }
   private:
     bool exists(const std::string& name) const {
       return (materials_.find(name) != materials_.end());
@@ -22,6 +22,12 @@ namespace material {
 		  double real_refractive_index = 1)
       : ac_{flick::absorption_coefficient(ac)}, sc_{flick::scattering_coefficient{sc}},
 	g_{flick::asymmetry_factor{g}}, real_refractive_index_{real_refractive_index} {}    
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<monocrome_iop>(*this);
+    }
+    bool is_homogeneous() const {
+      return true;
+    }
     double absorption_coefficient() const {
       return ac_();
     }
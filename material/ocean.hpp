@@ -89,6 +89,9 @@ each CDOM spectra given in mcdom_names.)");
       add_marine_cdom(); 
       auto_update_iops(true);
     }
+    std::shared_ptr<base> clone() const override {
+      return clone_as<ocean>();
+    }
     static stdvector height_grid(const basic_configuration& c) {
       double epsilon = 1e-6;      
       double depth = c.get<double>("bottom_depth");
@@ -55,6 +55,9 @@ namespace material {
       scattering_matrix_elements_.resize(row_.size());
       update_mie();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<spheres>(*this);
+    }
     void set_wavelength(double wl) {
       base::set_wavelength(wl);
       host_material_.set_wavelength(wl);
@@ -110,6 +113,9 @@ namespace material {
 				 log_normal_distribution(mu,sigma),
 				 material::pure_ice(),
 				 material::vacuum()) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<bubbles_in_ice>(*this);
+    }
   };
 
   template<class Monodispersed_mie>
@@ -125,6 +131,9 @@ namespace material {
 				 log_normal_distribution(mu,sigma),
 				 material::pure_water(),
 				 material::vacuum()) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<bubbles_in_water>(*this);
+    }
   };
   
   template<class Monodispersed_mie>
@@ -141,6 +150,9 @@ namespace material {
 				 log_normal_distribution(mu,sigma),
 				 material::pure_ice(),
 				 material::pure_water(salinity,273.15)) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<brines_in_ice>(*this);
+    }
   };
   
   template<class Monodispersed_mie>
@@ -156,6 +168,9 @@ namespace material {
 				 log_normal_distribution(mu,sigma),
 				 material::vacuum(),
 				 material::pure_water()) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<water_cloud>(*this);
+    }
   };
   
   template<class Monodispersed_mie>
@@ -171,6 +186,9 @@ namespace material {
 				 log_normal_distribution(mu,sigma),
 				 material::vacuum(),
 				 material::pure_ice()) {}
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<ice_cloud>(*this);
+    }
   }; 
 }
 }
@@ -16,6 +16,9 @@ namespace material {
       : monocrome_iop{ac, sc, flick::asymmetry_factor{p.asymmetry_factor()},
       real_refractive_index}, p_{p} {
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<tabulated>(*this);
+    }
     mueller mueller_matrix(const unit_vector& scattering_direction) const {
       mueller m;
       double theta = angle(scattering_direction);
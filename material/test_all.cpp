@@ -16,6 +16,7 @@ int main() {
   unit_test t("material");
   
   t.include<material_test_A>();
+  t.include<material_test_B>();
   t.include<iop_profile_test>();
   t.include<spheres_test_A>();
   t.include<spheres_test_B>();
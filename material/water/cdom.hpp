@@ -12,6 +12,9 @@ namespace material {
     cdom(double abs_coef_440 = 0.01, double slope_per_nm = 0.017)
       : abs_coef_440_{abs_coef_440}, slope_per_nm_{slope_per_nm} {
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<cdom>(*this);
+    }
     double absorption_coefficient() const {
       double wl_nm = wavelength()*1e9;
       return abs_coef_440_ * exp(-slope_per_nm_*(wl_nm-440));
@@ -15,6 +15,9 @@ namespace material {
     nap(double mass_concentration = 1e-3)
       : mass_concentration_{mass_concentration} {
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<nap>(*this);
+    }
     void mass_concentration(double c)
     // Dry mass concentration [kg/m^3]
     {  
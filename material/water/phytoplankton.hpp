@@ -23,6 +23,9 @@ namespace material {
       A_.add_constant_extrapolation();
       B_.add_constant_extrapolation();
     }
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<phytoplankton>(*this);
+    }
     void chl_concentration(double c) {
       chl_concentration_ = c;
     } 
@@ -225,6 +225,9 @@ namespace water {
       temperature_ = temperature;
       volume_fraction_ = volume_fraction;
     }   
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<pure_water>(*this);
+    }
     void salinity(const pl_function& s) {
       salinity_psu_ = s;
     }
@@ -15,6 +15,9 @@ namespace material {
     double real_refractive_index_{1};
   public:
     z_profile() = default;
+    std::shared_ptr<base> clone() const override {
+      return std::make_shared<z_profile<Function>>(*this);
+    }
     const iop_z_profile<Function>& a_profile() const {
       return a_profile_;
     }
@@ -24,6 +27,14 @@ namespace material {
     const stdvector& height_grid() const {
       return a_profile_.height_grid();
     }
+    stdvector profile_heights() const override {
+      stdvector h = a_profile_.height_grid();
+      const stdvector& s = s_profile_.height_grid();
+      h.insert(h.end(), s.begin(), s.end());
+      std::sort(h.begin(), h.end());
+      h.erase(std::unique(h.begin(), h.end()), h.end());
+      return h;
+    }
     virtual double real_refractive_index() const {
       return real_refractive_index_;
     } 
@@ -85,6 +96,15 @@ namespace material {
 	throw std::runtime_error("scaled_z_profile");
       make_iop_profile();
     } 
+    std::shared_ptr<base> clone() const override {
+      auto c = std::make_shared<scaled_z_profile<Function>>(*this);
+      c->m_ = m_->clone();
+      return c;
+    }
+    void set(const pose& p) override {
+      z_profile<Function>::set(p);
+      m_->set(p);
+    }
     void set_wavelength(double wl) override {
       m_->set_wavelength(wl);
       make_iop_profile();
@@ -0,0 +1,33 @@
+#include "../environment/benchmark.hpp"
+#include "monodispersed_mie.hpp"
+#include "polydispersed_mie.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("mie");
+  stdcomplex m_host{1.33,0};
+  stdcomplex m_sphere{1.5,1e-4};
+  double wl = 500e-9;
+  std::vector<double> angles = range(0,constants::pi,100).linspace();
+  monodispersed_mie mono_mie(m_host,m_sphere,wl);
+  mono_mie.angles(angles);
+  for (double r : {1e-6, 10e-6}) {
+    std::stringstream name;
+    name << "monodispersed_mie_radius_" << r*1e6 << "_um";
+    b.run(name.str(), [&]() {
+      mono_mie.radius(r);
+      return mono_mie.scattering_cross_section()
+	+ mono_mie.scattering_matrix_element(0,0)[0];
+    });
+  }
+  b.repetitions(1,5);
+  log_normal_distribution sd(log(1e-6),0.5);
+  b.run("polydispersed_mie", [&]() {
+    polydispersed_mie poly_mie(mono_mie,sd);
+    poly_mie.percentage_accuracy(1);
+    return poly_mie.scattering_cross_section()
+      + poly_mie.scattering_matrix_element(0,0)[0];
+  });
+  std::cout << b << std::endl;
+  return 0;
+}
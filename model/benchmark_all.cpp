@@ -0,0 +1,73 @@
+#include "../environment/benchmark.hpp"
+#include "single_layer_slab.hpp"
+#include "multilayer.hpp"
+#include "../material/henyey_greenstein.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("model");
+  b.repetitions(1,5);
+  for (bool kernel : {false, true}) {
+    std::string name = kernel ? "single_layer_slab_plane_parallel_kernel"
+      : "single_layer_slab";
+    b.run_counted(name, [&]() {
+      model::single_layer_slab s{thickness{1}};
+      s.fill<material::henyey_greenstein>(absorption_coefficient{0.1},
+					  scattering_coefficient{2},
+					  asymmetry_factor{0.8});
+      s.set_bottom(albedo{0.5});
+      s.adjust_accuracy(percentage{2});
+      s.use_plane_parallel_kernel(kernel);
+      s.hemispherical_reflectance();
+      return double(s.report().n_packages);
+    }, "packages");
+  }
+  for (size_t batch_size : {0, 1, 1024}) {
+    // Two scattering layers with Fresnel interfaces over a Lambert
+    // bottom, with the generic transporter for batch size 0
+    bool kernel = batch_size > 0;
+    std::string name = !kernel ? "plane_parallel_structure"
+      : batch_size == 1 ? "plane_parallel_structure_kernel"
+      : "plane_parallel_structure_kernel_batches";
+    size_t n = 20000;
+    b.run(name, [&]() {
+      model::layer l = model::bottom_layer<coating::grey_lambert>(0.5,0);
+      model::plane_parallel_structure s(l);
+      l = model::layer{thickness{1},"lower"};
+      l.fill<material::henyey_greenstein>(0.3,1.0,0.5,1.33);
+      s.add_on_top(l);
+      l = model::layer{thickness{1},"upper"};
+      l.fill<material::henyey_greenstein>(0.1,2.0,0.8,1.33);
+      l.activate_receivers();
+      s.add_on_top(l);
+      l = model::layer{thickness{1},"air"};
+      s.add_on_top(l);
+      s.use_plane_parallel_kernel(kernel);
+      s.set_batch_size(std::max<size_t>(batch_size, 1));
+      emitter em{{0,0,3.5},n};
+      em.set_direction<unidirectional>(unit_vector{constants::pi-0.5,0});
+      s.transport_radiation(em,"air");
+      return s.outward_receiver("upper").radiant_flux();
+    }, n, "packages");
+  }
+  for (size_t n_dimensions : {0, 4, 16}) {
+    // Packages needed for the accuracy, which falls faster than
+    // the inverse square root of their number with quasi-random
+    // dimensions
+    std::string name = "single_layer_slab_quasi_random_"
+      + std::to_string(n_dimensions);
+    b.run_counted(name, [&]() {
+      model::single_layer_slab s{thickness{1}};
+      s.fill<material::henyey_greenstein>(absorption_coefficient{0.1},
+					  scattering_coefficient{2},
+					  asymmetry_factor{0.8});
+      s.set_bottom(albedo{0.5});
+      s.adjust_accuracy(percentage{2});
+      s.use_quasi_random(n_dimensions);
+      s.hemispherical_reflectance();
+      return double(s.report().n_packages);
+    }, "packages");
+  }
+  std::cout << b << std::endl;
+  return 0;
+}
@@ -1,31 +1,86 @@
-#ifndef flick_distribution
-#define flick_distribution
+#ifndef flick_model_distribution
+#define flick_model_distribution
 
 namespace flick {
-  class distribution {
+namespace model {
+  enum class batching
+  // Each batch of packages twice the size of the previous, or all
+  // batches of equal size
+  {doubling, equal};
+
+  class distribution
+  // Mean of batch values weighted by the number of packages in each
+  // batch
+  {
     std::vector<double> weights_;
     std::vector<double> values_;
     double target_accuracy_;
     size_t n_packages_{100};
+    batching batching_;
+    static constexpr size_t min_equal_batches_{14};
   public:
-    distribution(double target_accuracy)
-      : target_accuracy_{target_accuracy} {
+    distribution(double target_accuracy, batching b = batching::doubling)
+      : target_accuracy_{target_accuracy}, batching_{b} {
       n_packages_ = 0.5/pow(target_accuracy,2);
+      if (batching_ == batching::equal)
+	n_packages_ = std::max<size_t>(n_packages_/2, 10);
     }
     size_t n_packages() const {
       return n_packages_;
     }
+    double target_accuracy() const {
+      return target_accuracy_;
+    }
+    size_t n_batches() const {
+      return values_.size();
+    }
+    size_t total_packages() const {
+      return total_weight();
+    }
     void add(double value) {
       weights_.push_back(n_packages_);
       values_.push_back(value);
-      n_packages_ *= 2;
+      if (batching_ == batching::doubling)
+	n_packages_ *= 2;
+    }
+    void add(double value, double n_packages)
+    // Batch of a given number of packages, as when batches of
+    // separate runs are merged
+    {
+      weights_.push_back(n_packages);
+      values_.push_back(value);
+    }
+    const std::vector<double>& batch_packages() const {
+      return weights_;
+    }
+    const std::vector<double>& batch_values() const {
+      return values_;
+    }
+    void write_state(std::ostream& os) const {
+      write_binary(os, weights_);
+      write_binary(os, values_);
+      write_binary(os, n_packages_);
+    }
+    void read_state(std::istream& is) {
+      read_binary(is, weights_);
+      read_binary(is, values_);
+      read_binary(is, n_packages_);
     }
     bool bad_accuracy() const {
-      if (values_.size() < 3 or !(mean() > std::numeric_limits<double>::epsilon()))
+      size_t min_batches = 3;
+      if (batching_ == batching::equal)
+	min_batches = min_equal_batches_;
+      if (values_.size() < min_batches or !(mean() > std::numeric_limits<double>::epsilon()))
 	return true;
       return target_accuracy_ < accuracy(); 
     }
-    double accuracy() const {
+    double accuracy() const
+    // Relative spread of batch values. With equal batches, twice the
+    // standard error of the mean of batch values relative to the
+    // mean, which is the half width of a 95% confidence interval.
+    {
+      if (batching_ == batching::equal)
+	return 2*std()/sqrt(values_.size()-1)/mean();
       return std()/mean();
     }
     double mean() const {
@@ -59,5 +114,6 @@ namespace flick {
     }
   };
 }
+}
 
 #endif
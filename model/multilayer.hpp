@@ -3,6 +3,7 @@
 
 #include "../numeric/histogram.hpp"
 #include "../transporter/ordinary_mc.hpp"
+#include "../transporter/plane_parallel_mc.hpp"
 //#include "distribution.hpp"
 
 namespace flick {
@@ -75,6 +76,7 @@ namespace model {
     std::shared_ptr<transporter::ordinary_mc> omc_;
   protected:
     std::vector<layer> layers_;
+    double sampling_asymmetry_factor_{0.7};
   public:
     layered_structure() = default;
     layered_structure(const layer& bottom)
@@ -88,8 +90,7 @@ namespace model {
     void transport_radiation(const emitter& em,
 			     const std::string& volume_name) {
       omc_ = std::make_shared<transporter::ordinary_mc>(volume_);
-      double g = 0.7;
-      omc_->transport_radiation(em,volume_name,g);
+      omc_->transport_radiation(em,volume_name,sampling_asymmetry_factor_);
     }
     receiver& outward_receiver(const std::string& layer_name) {
       return omc_->outward_receiver(layer_name); 
@@ -125,9 +126,48 @@ namespace model {
     }
   };
    
-  class plane_parallel_structure : public layered_structure<semi_infinite_box> {
+  class plane_parallel_structure : public layered_structure<semi_infinite_box>
+  {
+    std::shared_ptr<transporter::plane_parallel_mc> ppmc_;
+    bool uses_plane_parallel_kernel_{false};
+    size_t batch_size_{1};
   public:
     using layered_structure::layered_structure;
+    void use_plane_parallel_kernel(bool on)
+    // Follow packages by height and layer instead of navigating the
+    // volume tree. Packages are then unpolarized. Spectral emitters
+    // are still transported through the volume tree.
+    {
+      uses_plane_parallel_kernel_ = on;
+    }
+    void set_batch_size(size_t n)
+    // Packages moved together by the plane-parallel kernel
+    {
+      if (n < 1)
+	throw std::runtime_error("plane_parallel_structure batch size");
+      batch_size_ = n;
+    }
+    void transport_radiation(const emitter& em,
+			     const std::string& volume_name) {
+      ppmc_.reset();
+      if (!uses_plane_parallel_kernel_ || em.is_spectral()) {
+	layered_structure::transport_radiation(em,volume_name);
+	return;
+      }
+      ppmc_ = std::make_shared<transporter::plane_parallel_mc>(volume());
+      ppmc_->set_batch_size(batch_size_);
+      ppmc_->transport_radiation(em,volume_name,sampling_asymmetry_factor_);
+    }
+    receiver& outward_receiver(const std::string& layer_name) {
+      if (ppmc_)
+	return ppmc_->outward_receiver(layer_name);
+      return layered_structure::outward_receiver(layer_name);
+    }
+    receiver& inward_receiver(const std::string& layer_name) {
+      if (ppmc_)
+	return ppmc_->inward_receiver(layer_name);
+      return layered_structure::inward_receiver(layer_name);
+    }
     void add_on_top(const layer& l) {
       semi_infinite_box b;  
       pose p = volume().placement();
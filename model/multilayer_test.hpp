@@ -27,5 +27,8 @@ namespace flick {
     em.set_direction<unidirectional>(unit_vector{0,0,1});
     s.transport_radiation(em,"hg1");
     check(s.outward_receiver("hg2").radiant_flux()>0);
+    s.use_plane_parallel_kernel(true);
+    s.transport_radiation(em,"hg1");
+    check(s.outward_receiver("hg2").radiant_flux()>0);
   } end_test_case()
 }
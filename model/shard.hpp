@@ -0,0 +1,129 @@
+#ifndef flick_shard
+#define flick_shard
+
+#include <set>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "distribution.hpp"
+
+namespace flick {
+namespace model {
+  class shard
+  // Batches of one estimate made by process index of count
+  // independent processes. Processes of a run share a seed and a
+  // label describing the simulation, and use random streams far
+  // apart. Shards are kept in binary files, and any number of them
+  // can be merged into one estimate.
+  {
+    std::string label_;
+    uint64_t index_{0};
+    uint64_t count_{1};
+    uint64_t seed_{0};
+    std::vector<double> packages_;
+    std::vector<double> values_;
+  public:
+    static constexpr char magic[8] = {'f','l','i','c','k','s','h','1'};
+    shard() = default;
+    shard(const std::string& label, uint64_t index, uint64_t count,
+	  uint64_t seed)
+      : label_{label}, index_{index}, count_{count}, seed_{seed} {
+      if (count < 1 || index >= count)
+	throw std::runtime_error("shard index");
+    }
+    static uint64_t first_stream(uint64_t index)
+    // Random stream of the first package of a shard, leaving room
+    // for 2^32 thread streams in each shard
+    {
+      return index << 32;
+    }
+    void add(const distribution& d) {
+      packages_.insert(packages_.end(), d.batch_packages().begin(),
+		       d.batch_packages().end());
+      values_.insert(values_.end(), d.batch_values().begin(),
+		     d.batch_values().end());
+    }
+    const std::string& label() const {
+      return label_;
+    }
+    uint64_t index() const {
+      return index_;
+    }
+    uint64_t count() const {
+      return count_;
+    }
+    uint64_t seed() const {
+      return seed_;
+    }
+    size_t n_batches() const {
+      return values_.size();
+    }
+    void write(const std::string& file_name) const {
+      std::ofstream ofs(file_name, std::ios::binary);
+      if (!ofs)
+	throw std::runtime_error("shard write");
+      uint64_t header[5] = {index_, count_, seed_, label_.size(),
+	values_.size()};
+      ofs.write(magic, sizeof(magic));
+      ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+      ofs.write(label_.data(), label_.size());
+      ofs.write(reinterpret_cast<const char*>(packages_.data()),
+		packages_.size()*sizeof(double));
+      ofs.write(reinterpret_cast<const char*>(values_.data()),
+		values_.size()*sizeof(double));
+      if (!ofs)
+	throw std::runtime_error("shard write");
+    }
+    static shard read(const std::string& file_name) {
+      std::ifstream ifs(file_name, std::ios::binary);
+      if (!ifs)
+	throw std::runtime_error("shard read");
+      char m[sizeof(magic)];
+      uint64_t header[5];
+      ifs.read(m, sizeof(m));
+      ifs.read(reinterpret_cast<char*>(header), sizeof(header));
+      if (!ifs || std::memcmp(m, magic, sizeof(magic)) != 0)
+	throw std::runtime_error("shard format");
+      shard s;
+      s.index_ = header[0];
+      s.count_ = header[1];
+      s.seed_ = header[2];
+      s.label_.resize(header[3]);
+      s.packages_.resize(header[4]);
+      s.values_.resize(header[4]);
+      ifs.read(s.label_.data(), s.label_.size());
+      ifs.read(reinterpret_cast<char*>(s.packages_.data()),
+	       s.packages_.size()*sizeof(double));
+      ifs.read(reinterpret_cast<char*>(s.values_.data()),
+	       s.values_.size()*sizeof(double));
+      if (!ifs || s.count_ < 1 || s.index_ >= s.count_)
+	throw std::runtime_error("shard format");
+      return s;
+    }
+    friend distribution merge(const std::vector<shard>& shards);
+  };
+
+  distribution merge(const std::vector<shard>& shards)
+  // Pools the batches of shards of the same run, with different
+  // indices, so that the accuracy is that of one run with all
+  // batches
+  {
+    if (shards.empty())
+      throw std::runtime_error("shard merge");
+    distribution d{1, batching::equal};
+    std::set<uint64_t> indices;
+    for (const shard& s : shards) {
+      if (s.label_ != shards[0].label_ || s.seed_ != shards[0].seed_
+	  || s.count_ != shards[0].count_ || !indices.insert(s.index_).second)
+	throw std::runtime_error("shard merge");
+      for (size_t i=0; i<s.values_.size(); ++i)
+	d.add(s.values_[i], s.packages_[i]);
+    }
+    return d;
+  }
+}
+}
+
+#endif
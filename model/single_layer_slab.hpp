@@ -1,14 +1,43 @@
 #ifndef flick_single_layer_slab
 #define flick_single_layer_slab
 
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <typeinfo>
 #include "../numeric/named_bounded_types.hpp"
 #include "../transporter/ordinary_mc.hpp"
+#include "../transporter/plane_parallel_mc.hpp"
 #include "distribution.hpp"
+#include "shard.hpp"
 
 namespace flick {
 namespace model {
+  struct sampling_report
+  // Work spent on one estimate
+  {
+    size_t n_packages{0};
+    size_t n_batches{0};
+    double accuracy{0};
+    double wall_time{0};
+  };
+
+  enum class slab_quantity
+  // Quantities that several estimates of one run can be made of
+  {hemispherical_reflectance, hemispherical_transmittance, relative_radiance};
+
   class single_layer_slab
   {
+    struct added_estimate {
+      slab_quantity quantity{slab_quantity::hemispherical_reflectance};
+      double relative_depth{0};
+      unit_vector direction{0,0};
+      double acceptance_angle{0};
+      std::optional<double> accuracy{};
+      receiver* reflected{nullptr};
+      receiver* transmitted{nullptr};
+    };
     thickness h_;
     zenith_angle theta_0_{0};
     albedo albedo_{0};
@@ -18,8 +47,29 @@ namespace model {
     receiver* transmitted_;
     receiver* reflected_;
     double relative_depth_{0};
+    std::vector<double> sheet_depths_;
+    std::vector<added_estimate> estimates_;
+    std::vector<sampling_report> reports_;
+    std::vector<distribution> estimate_batches_;
     stokes stokes_{stokes::unpolarized()};
+    tally tally_;
+    size_t n_threads_{1};
+    transporter::scattering_sampling scattering_sampling_
+    {transporter::scattering_sampling::henyey_greenstein};
+    transporter::weight_window weight_window_;
     std::shared_ptr<transporter::ordinary_mc> omc_;
+    std::shared_ptr<transporter::plane_parallel_mc> ppmc_;
+    bool uses_plane_parallel_kernel_{false};
+    bool collects_statistics_{false};
+    transporter::transport_statistics statistics_;
+    sampling_report report_;
+    std::optional<uint64_t> seed_;
+    uint64_t shard_index_{0};
+    uint64_t shard_count_{1};
+    distribution batches_{1, batching::equal};
+    transporter::checkpoint checkpoint_;
+    uint64_t n_estimates_{0};
+    size_t quasi_random_dimensions_{0};
   public:
     single_layer_slab(const thickness& h) : h_{h} {
     }
@@ -29,6 +79,103 @@ namespace model {
     void adjust_accuracy(const percentage& p) {
       accuracy_ = p()/100;
     }
+    void set_threads(size_t n_threads) {
+      n_threads_ = n_threads;
+    }
+    void set_seed(uint64_t seed)
+    // Makes estimates reproducible for a given seed, shard and number
+    // of threads
+    {
+      seed_ = seed;
+    }
+    void set_shard(uint64_t index, uint64_t count)
+    // Makes this process shard index of count processes sharing one
+    // estimate. Random streams of different shards never overlap when
+    // they use the same seed, which is 0 unless set. Each shard aims
+    // at an accuracy sqrt(count) times the adjusted one, so that the
+    // merged estimate reaches the adjusted accuracy.
+    {
+      if (count < 1 || index >= count)
+	throw std::runtime_error("single_layer_slab shard");
+      shard_index_ = index;
+      shard_count_ = count;
+    }
+    model::shard partial_tally(const std::string& label) const
+    // Batches of the last estimate, to be merged with those of other
+    // shards. The label should describe the simulation and quantity.
+    {
+      model::shard s{label, shard_index_, shard_count_, seed_.value_or(0)};
+      s.add(batches_);
+      return s;
+    }
+    model::shard partial_tally(const std::string& label, size_t estimate) const
+    // Batches of an added estimate in the last run of all estimates
+    {
+      model::shard s{label, shard_index_, shard_count_, seed_.value_or(0)};
+      s.add(estimate_batches_.at(estimate));
+      return s;
+    }
+    void set_checkpoint(const std::string& file_name, size_t packages,
+			double seconds = 0)
+    // Estimates write their batches and transport state to file_name
+    // after a batch once packages have been transported and seconds
+    // of wall time have passed since the last write, and when they
+    // are done. An estimate finding a checkpoint of itself, the same
+    // estimate counted from this call, continues from it, and throws
+    // if the checkpoint was written with another seed, shard, number
+    // of threads, checkpoint packages or configuration of the slab
+    // and estimate. With a seed, the result is that of an
+    // uninterrupted estimate.
+    {
+      checkpoint_ = {file_name, packages, seconds};
+      n_estimates_ = 0;
+    }
+    void set_scattering_sampling(transporter::scattering_sampling s) {
+      scattering_sampling_ = s;
+    }
+    void set_russian_roulette(double threshold, double survival_weight) {
+      weight_window_.set_russian_roulette(threshold, survival_weight);
+    }
+    void set_splitting(double threshold, size_t max_copies) {
+      weight_window_.set_splitting(threshold, max_copies);
+    }
+    void set_interface_splitting(bool on) {
+      weight_window_.set_interface_splitting(on);
+    }
+    void use_plane_parallel_kernel(bool on)
+    // Follow packages by height and layer instead of navigating the
+    // volume tree. Packages are then unpolarized, and splitting at
+    // interfaces is not available.
+    {
+      uses_plane_parallel_kernel_ = on;
+    }
+    void use_quasi_random(size_t n_dimensions)
+    // Draw the first n_dimensions numbers of each package from a
+    // scrambled Sobol sequence, which is scrambled anew for each
+    // batch. Batches are then independent randomizations, and the
+    // accuracy follows from their spread as before. Not with the
+    // plane parallel kernel.
+    {
+      if (n_dimensions > sobol_sequence::max_dimensions)
+	throw std::runtime_error("single_layer_slab quasi-random");
+      quasi_random_dimensions_ = n_dimensions;
+    }
+    const transporter::weight_window_statistics& variance_reduction_statistics() const
+    // Summed over all runs of this slab
+    {
+      return weight_window_.statistics();
+    }
+    void collect_statistics(bool on)
+    // Count transport events and time transport phases. Not
+    // available with the plane-parallel kernel.
+    {
+      collects_statistics_ = on;
+    }
+    const transporter::transport_statistics& event_statistics() const
+    // Summed over all runs of this slab
+    {
+      return statistics_;
+    }
     void orient_source(const zenith_angle& za) {
       theta_0_ = za;
     }
@@ -43,12 +190,10 @@ namespace model {
 				     = unit_interval{0})
     // See Wikipedia reflectance for definition
     {
-      distribution d{accuracy_};
-      while(d.bad_accuracy()) {
-	run(d.n_packages(),relative_depth);
-	d.add(reflected_->radiant_flux()/d.n_packages());
-      }
-      return d.mean();
+      tally_ = tally();
+      return estimate(relative_depth, [&]() {
+	return reflected_->radiant_flux();
+      });
     }
     double relative_radiance(const polar_angle& pa,
 			     const azimuth_angle& aa,
@@ -59,27 +204,104 @@ namespace model {
     // Radiance in a given propagation direction relative to incoming
     // surface irradiance.
     {
-      distribution d{accuracy_};
-      while(d.bad_accuracy()) {
-	run(d.n_packages(),relative_depth);
-	unit_vector direction{pa(),aa()};
+      unit_vector direction{pa(),aa()};
+      tally_ = tally().radiance_cone(direction, acceptance_angle());
+      return estimate(relative_depth, [&]() {
 	double L_r = reflected_->radiance(direction, acceptance_angle());
 	double L_t = transmitted_->radiance(direction, acceptance_angle());
-	d.add((L_r + L_t) / d.n_packages());
-	//std::cout << d << std::endl;
-      }
-      return d.mean();
+	return L_r + L_t;
+      });
     }
     double hemispherical_transmittance(const unit_interval& relative_depth
 				       = unit_interval{1})
     // See Wikipedia transmittance for definition
     {
-      distribution d{accuracy_};
-      while(d.bad_accuracy()) {
-	run(d.n_packages(),relative_depth);
-	d.add(transmitted_->radiant_flux()/d.n_packages());
+      tally_ = tally();
+      return estimate(relative_depth, [&]() {
+	return transmitted_->radiant_flux();
+      });
+    }
+    size_t add_hemispherical_reflectance(const unit_interval& relative_depth
+					 = unit_interval{0})
+    // Adds an estimate to be made by estimate_all, returning its
+    // number
+    {
+      return add_estimate({slab_quantity::hemispherical_reflectance,
+	  relative_depth(), unit_vector{0,0}, 0});
+    }
+    size_t add_hemispherical_transmittance(const unit_interval& relative_depth
+					   = unit_interval{1}) {
+      return add_estimate({slab_quantity::hemispherical_transmittance,
+	  relative_depth(), unit_vector{0,0}, 0});
+    }
+    size_t add_relative_radiance(const polar_angle& pa,
+				 const azimuth_angle& aa,
+				 const vertex_angle& acceptance_angle
+				 = vertex_angle{1},
+				 const unit_interval& relative_depth
+				 = unit_interval{0}) {
+      return add_estimate({slab_quantity::relative_radiance,
+	  relative_depth(), unit_vector{pa(),aa()}, acceptance_angle()});
+    }
+    void adjust_accuracy(size_t estimate, const percentage& p)
+    // Own accuracy of an added estimate, instead of the adjusted
+    // accuracy of the slab
+    {
+      estimates_.at(estimate).accuracy = p()/100;
+    }
+    size_t n_estimates() const {
+      return estimates_.size();
+    }
+    void clear_estimates() {
+      estimates_.clear();
+    }
+    std::vector<double> estimate_all()
+    // Transports equal batches of packages once for all added
+    // estimates, through a slab with receivers at each of their
+    // depths, until every estimate reaches its accuracy. Batches are
+    // sized for the most accurate estimate. Estimates are returned in
+    // the order they were added.
+    {
+      if (estimates_.empty())
+	throw std::runtime_error("single_layer_slab estimates");
+      auto start = std::chrono::steady_clock::now();
+      prepare_all();
+      std::vector<distribution> ds;
+      for (const added_estimate& e : estimates_) {
+	double accuracy = e.accuracy.value_or(accuracy_);
+	ds.emplace_back(accuracy*sqrt(double(shard_count_)), batching::equal);
       }
-      return d.mean();
+      run_batches(ds, [&]() {
+	std::vector<double> sums;
+	for (const added_estimate& e : estimates_)
+	  sums.push_back(measure(e));
+	return sums;
+      });
+      std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+      reports_.clear();
+      std::vector<double> means;
+      double worst = 0;
+      for (const distribution& d : ds) {
+	reports_.push_back({d.total_packages(), d.n_batches(), d.accuracy(),
+	    t.count()});
+	means.push_back(d.mean());
+	worst = std::max(worst, d.accuracy());
+      }
+      report_ = {ds[0].total_packages(), ds[0].n_batches(), worst, t.count()};
+      estimate_batches_ = ds;
+      return means;
+    }
+    const sampling_report& report() const
+    // Packages, batches, reached accuracy and wall time in seconds
+    // spent on the last estimate, or on the last run of all
+    // estimates with the worst accuracy of them
+    {
+      return report_;
+    }
+    const std::vector<sampling_report>& reports() const
+    // Reports of each added estimate in the last run of all estimates
+    {
+      return reports_;
     }
     const receiver& reflection_receiver() const {
       return *reflected_;
@@ -88,59 +310,272 @@ namespace model {
       return *transmitted_;
     }
   private:
+    template<class Measure>
+    double estimate(const unit_interval& relative_depth, Measure measure)
+    // Transports equal batches of packages through the same geometry
+    // until the batch means reach the accuracy. The measure sums over
+    // all packages transported so far.
+    {
+      auto start = std::chrono::steady_clock::now();
+      prepare(relative_depth);
+      std::vector<distribution> ds{{accuracy_*sqrt(double(shard_count_)),
+	  batching::equal}};
+      run_batches(ds, [&]() {
+	return std::vector<double>{measure()};
+      });
+      std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+      const distribution& d = ds[0];
+      report_ = {d.total_packages(), d.n_batches(), d.accuracy(), t.count()};
+      batches_ = d;
+      return d.mean();
+    }
+    template<class Measure>
+    void run_batches(std::vector<distribution>& ds, Measure measure)
+    // Transports batches of the largest package count of ds until
+    // every distribution reaches its accuracy, continuing from a
+    // checkpoint of the same estimate. The measure returns one sum
+    // over all packages transported so far for each distribution.
+    {
+      size_t n_packages = 0;
+      for (const distribution& d : ds)
+	n_packages = std::max(n_packages, d.n_packages());
+      std::vector<double> previous(ds.size(), 0);
+      uint64_t n_estimate = n_estimates_++;
+      std::array<uint64_t,8> header{n_estimate, is_seeded(), seed_.value_or(0),
+	shard_index_, shard_count_, n_threads_, checkpoint_.packages(),
+	configuration_fingerprint(ds)};
+      if (checkpoint_.is_enabled())
+	checkpoint_.read([&](std::istream& is) {
+	  std::array<uint64_t,8> found;
+	  read_binary(is, found);
+	  if (transporter::checkpoint::is_continued(found, header, 0)) {
+	    for (distribution& d : ds)
+	      d.read_state(is);
+	    read_binary(is, previous);
+	    read_transport_state(is);
+	  }
+	});
+      auto bad_accuracy = [&]() {
+	return std::any_of(ds.begin(), ds.end(), [](const distribution& d) {
+	  return d.bad_accuracy();
+	});
+      };
+      while (bad_accuracy()) {
+	transport(n_packages);
+	std::vector<double> current = measure();
+	for (size_t i=0; i<ds.size(); ++i)
+	  ds[i].add((current[i] - previous[i]) / n_packages, n_packages);
+	previous = current;
+	if (checkpoint_.is_enabled()) {
+	  checkpoint_.count(n_packages);
+	  if (checkpoint_.is_due() || !bad_accuracy())
+	    checkpoint_.write([&](std::ostream& os) {
+	      write_binary(os, header);
+	      for (const distribution& d : ds)
+		d.write_state(os);
+	      write_binary(os, previous);
+	      write_transport_state(os);
+	    });
+	}
+      }
+      add_run_statistics();
+    }
+    uint64_t configuration_fingerprint(const std::vector<distribution>& ds)
+    // Slab, sampling settings and the batches and accuracies of an
+    // estimate
+    {
+      std::ostringstream os;
+      os.precision(17);
+      os << h_() << " " << theta_0_() << " " << albedo_() << " " << accuracy_
+	 << " " << relative_depth_ << " " << stokes_
+	 << " " << int(scattering_sampling_) << " " << weight_window_
+	 << " " << uses_plane_parallel_kernel_ << " " << quasi_random_dimensions_;
+      if (material_) {
+	material_->set(pose{});
+	os << " " << typeid(*material_).name() << *material_;
+      }
+      for (double d : sheet_depths_)
+	os << " " << d;
+      for (const added_estimate& e : estimates_)
+	os << " " << int(e.quantity) << " " << e.relative_depth << " "
+	   << e.direction << " " << e.acceptance_angle << " "
+	   << e.accuracy.value_or(-1);
+      for (const distribution& d : ds)
+	os << " " << d.n_packages() << " " << d.target_accuracy();
+      return transporter::checkpoint::fingerprint(os.str());
+    }
+    size_t add_estimate(const added_estimate& e) {
+      estimates_.push_back(e);
+      return estimates_.size()-1;
+    }
+    double measure(const added_estimate& e) {
+      using enum slab_quantity;
+      if (e.quantity == hemispherical_reflectance)
+	return e.reflected->radiant_flux();
+      if (e.quantity == hemispherical_transmittance)
+	return e.transmitted->radiant_flux();
+      return e.reflected->radiance(e.direction, e.acceptance_angle)
+	+ e.transmitted->radiance(e.direction, e.acceptance_angle);
+    }
+    void add_run_statistics() {
+      if (ppmc_)
+	weight_window_.add_statistics(ppmc_->variance_reduction_statistics());
+      else {
+	weight_window_.add_statistics(omc_->variance_reduction_statistics());
+	statistics_.add(omc_->event_statistics());
+      }
+    }
+    void write_transport_state(std::ostream& os) {
+      if (ppmc_)
+	ppmc_->write_state(os);
+      else
+	omc_->write_state(os);
+    }
+    void read_transport_state(std::istream& is) {
+      if (ppmc_)
+	ppmc_->read_state(is);
+      else
+	omc_->read_state(is);
+    }
+    bool is_seeded() const {
+      return seed_ || shard_count_ > 1;
+    }
     double relative_skin_depth() {
       return geometry_.small_step()/h_()*2;
     }
-    double sheet_relative_depth() {
+    double sheet_relative_depth(double relative_depth) {
       double epsilon = relative_skin_depth();
-      return std::clamp<double>(relative_depth_,epsilon,1-epsilon);
+      return std::clamp<double>(relative_depth,epsilon,1-epsilon);
+    }
+    static std::string sheet_name(size_t n) {
+      return "sheet" + std::to_string(n);
+    }
+    std::string sheet_at(double relative_depth) {
+      double d = sheet_relative_depth(relative_depth);
+      auto i = std::find(sheet_depths_.begin(), sheet_depths_.end(), d);
+      return sheet_name(i - sheet_depths_.begin());
+    }
+    receiver& inward_receiver(const std::string& volume_name) {
+      if (ppmc_)
+	return ppmc_->inward_receiver(volume_name);
+      return omc_->inward_receiver(volume_name);
+    }
+    receiver& outward_receiver(const std::string& volume_name) {
+      if (ppmc_)
+	return ppmc_->outward_receiver(volume_name);
+      return omc_->outward_receiver(volume_name);
+    }
+    receiver& reflection_receiver_at(double relative_depth) {
+      if (relative_depth <= relative_skin_depth())
+	return outward_receiver("surface");
+      return outward_receiver(sheet_at(relative_depth));
+    }
+    receiver& transmission_receiver_at(double relative_depth) {
+      if (relative_depth >= 1-relative_skin_depth())
+	return inward_receiver("bottom");
+      return inward_receiver(sheet_at(relative_depth));
     }
     void find_receivers() {
-      transmitted_ = &omc_->inward_receiver("sheet");
-      reflected_ = &omc_->outward_receiver("sheet");
-
-      double epsilon = relative_skin_depth();
-      if (relative_depth_ <= epsilon) {
-	reflected_ = &omc_->outward_receiver("surface");
-      }
-      else if (relative_depth_ >= 1-epsilon) {
-	transmitted_ = &omc_->inward_receiver("bottom");
-      }
+      transmitted_ = &transmission_receiver_at(relative_depth_);
+      reflected_ = &reflection_receiver_at(relative_depth_);
     }
-    void build_geometry() {
+    void build_geometry(std::vector<double> relative_depths)
+    // With a receiving sheet at each depth
+    {
+      for (double& d : relative_depths)
+	d = sheet_relative_depth(d);
+      std::sort(relative_depths.begin(), relative_depths.end());
+      relative_depths.erase(std::unique(relative_depths.begin(),
+					relative_depths.end()),
+			    relative_depths.end());
+      sheet_depths_ = relative_depths;
       semi_infinite_box surface;
-      semi_infinite_box sheet;
       semi_infinite_box bottom;
       geometry_.name("geometry");
       surface.name("surface");
-      sheet.name("sheet");
       bottom.name("bottom");
       surface().inward_receiver().activate();
+      surface().inward_receiver().use(tally_);
       surface().outward_receiver().activate();
+      surface().outward_receiver().use(tally_);
       surface().fill(material_);
-      sheet().inward_receiver().activate();
-      sheet().outward_receiver().activate();
-      sheet().fill(material_);
       bottom().inward_receiver().activate();
+      bottom().inward_receiver().use(tally_);
       bottom().coat<coating::grey_lambert>(albedo_(),1-albedo_());
       geometry_.move_by({0,0,h_()+1});
       surface.move_by({0,0,h_()});
-      sheet.move_by({0,0,h_()*(1-sheet_relative_depth())});
-      sheet.insert(bottom);
-      surface.insert(sheet);
+      semi_infinite_box inner = bottom;
+      for (size_t i=sheet_depths_.size(); i-- > 0;) {
+	semi_infinite_box sheet;
+	sheet.name(sheet_name(i));
+	sheet().inward_receiver().activate();
+	sheet().inward_receiver().use(tally_);
+	sheet().outward_receiver().activate();
+	sheet().outward_receiver().use(tally_);
+	sheet().fill(material_);
+	sheet.move_by({0,0,h_()*(1-sheet_depths_[i])});
+	sheet.insert(inner);
+	inner = sheet;
+      }
+      surface.insert(inner);
       geometry_.clear();
       geometry_.insert(surface);
     }
-    void run(size_t n_packages, const unit_interval& relative_depth) {
+    void prepare(const unit_interval& relative_depth) {
       relative_depth_ = relative_depth();
+      build_geometry({relative_depth_});
+      make_transporter();
+      find_receivers();
+    }
+    void prepare_all() {
+      tally_ = tally();
+      std::vector<double> depths;
+      for (const added_estimate& e : estimates_) {
+	depths.push_back(e.relative_depth);
+	if (e.quantity == slab_quantity::relative_radiance)
+	  tally_.radiance_cone(e.direction, e.acceptance_angle);
+      }
+      build_geometry(depths);
+      make_transporter();
+      for (added_estimate& e : estimates_) {
+	e.reflected = &reflection_receiver_at(e.relative_depth);
+	e.transmitted = &transmission_receiver_at(e.relative_depth);
+      }
+      relative_depth_ = estimates_[0].relative_depth;
+      find_receivers();
+    }
+    void make_transporter() {
+      omc_.reset();
+      ppmc_.reset();
+      if (uses_plane_parallel_kernel_) {
+	if (quasi_random_dimensions_ > 0)
+	  throw std::runtime_error("single_layer_slab quasi-random");
+	ppmc_ = std::make_shared<transporter::plane_parallel_mc>(geometry_);
+	ppmc_->set_threads(n_threads_);
+	if (is_seeded())
+	  ppmc_->set_seed(seed_.value_or(0), shard::first_stream(shard_index_));
+	ppmc_->set_scattering_sampling(scattering_sampling_);
+	ppmc_->set_weight_window(weight_window_);
+      } else {
+	omc_ = std::make_shared<transporter::ordinary_mc>(geometry_);
+	omc_->set_threads(n_threads_);
+	if (is_seeded())
+	  omc_->set_seed(seed_.value_or(0), shard::first_stream(shard_index_));
+	omc_->set_scattering_sampling(scattering_sampling_);
+	omc_->set_weight_window(weight_window_);
+	omc_->collect_statistics(collects_statistics_);
+	omc_->set_quasi_random(quasi_random_dimensions_);
+      }
+    }
+    void transport(size_t n_packages) {
       emitter emitter{{0,0,h_()+0.5},stokes_,n_packages};
       unit_vector direction{constants::pi-theta_0_(),0}; 
       emitter.set_direction<unidirectional>(direction);
-      build_geometry();
       double g = material_->asymmetry_factor();
-      omc_ = std::make_shared<transporter::ordinary_mc>(geometry_);
-      omc_->transport_radiation(emitter,"geometry",g);
-      find_receivers();
+      if (ppmc_)
+	ppmc_->transport_radiation(emitter,"geometry",g);
+      else
+	omc_->transport_radiation(emitter,"geometry",g);
     }
   };
 }
@@ -1,3 +1,4 @@
+#include <filesystem>
 #include "single_layer_slab.hpp"
 #include "../material/henyey_greenstein.hpp"
 
@@ -185,4 +186,200 @@ namespace flick {
     check_close(slab.hemispherical_reflectance(),1,0.0001);
     */
   } end_test_case()
+
+  begin_test_case(single_layer_slab_test_J) {
+    using namespace flick;
+    absorption_coefficient a{0};
+    scattering_coefficient b{1};
+    asymmetry_factor g{0};
+    model::single_layer_slab slab{thickness{1}};
+    slab.fill<material::henyey_greenstein>(a,b,g);
+    slab.set_bottom(albedo{0});
+    slab.adjust_accuracy(p);
+    slab.set_threads(3);
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p259, FLUX
+    check_close(slab.hemispherical_transmittance(),0.65867, p());
+  } end_test_case()
+
+  begin_test_case(single_layer_slab_test_K) {
+    using namespace flick;
+    model::single_layer_slab slab{thickness{1}};
+    slab.fill<material::henyey_greenstein>(absorption_coefficient{0},
+					   scattering_coefficient{1},
+					   asymmetry_factor{0});
+    slab.set_bottom(albedo{0});
+    slab.adjust_accuracy(percentage{2});
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p259, FLUX
+    check_close(slab.hemispherical_transmittance(),0.65867,2);
+    model::sampling_report r = slab.report();
+    check(r.n_batches >= 10);
+    check(r.n_packages > 0);
+    check(r.accuracy <= 0.02);
+    check(r.wall_time > 0);
+  } end_test_case()
+
+  begin_test_case(single_layer_slab_test_L) {
+    using namespace flick;
+    model::single_layer_slab slab{thickness{1}};
+    slab.fill<material::henyey_greenstein>(absorption_coefficient{0},
+					   scattering_coefficient{1},
+					   asymmetry_factor{0});
+    slab.set_bottom(albedo{0});
+    slab.use_plane_parallel_kernel(true);
+    slab.adjust_accuracy(percentage{2});
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p259, FLUX
+    check_close(slab.hemispherical_transmittance(),0.65867,3);
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p258, FLUX
+    check_close(slab.hemispherical_reflectance(),0.34133,3);
+  } end_test_case()
+
+  begin_test_case(single_layer_slab_test_M) {
+    using namespace flick;
+    // Shards of one run should merge to the unsharded estimate
+    auto run = [](uint64_t index) {
+      model::single_layer_slab slab{thickness{1}};
+      slab.fill<material::henyey_greenstein>(absorption_coefficient{0},
+					     scattering_coefficient{1},
+					     asymmetry_factor{0});
+      slab.set_bottom(albedo{0});
+      slab.adjust_accuracy(percentage{3});
+      slab.set_seed(7);
+      slab.set_shard(index, 3);
+      double t = slab.hemispherical_transmittance();
+      return std::make_pair(t, slab.partial_tally("transmittance"));
+    };
+    std::vector<model::shard> shards;
+    std::filesystem::path file = std::filesystem::temp_directory_path()
+      / "single_layer_slab_test_M.bin";
+    for (uint64_t i=0; i<3; ++i) {
+      run(i).second.write(file.string());
+      shards.push_back(model::shard::read(file.string()));
+    }
+    std::filesystem::remove(file);
+    auto [t, s] = run(1);
+    check(t == run(1).first);
+    check(t != run(0).first);
+    check(s.n_batches() == shards[1].n_batches());
+    check(shards[1].label() == "transmittance");
+    model::distribution d = model::merge(shards);
+    check(d.n_batches() == shards[0].n_batches() + shards[1].n_batches()
+	  + shards[2].n_batches());
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p259, FLUX
+    check_close(d.mean(), 0.65867, 3);
+    check(d.accuracy() < 0.05);
+    shards.push_back(shards[0]);
+    check_throw(model::merge(shards));
+    check_throw(model::merge({shards[0], model::shard{"reflectance", 1, 3, 7}}));
+    check_throw(model::shard("transmittance", 3, 3, 7));
+  } end_test_case()
+
+  struct interrupting_material : public material::henyey_greenstein
+  // Throws at a given batch, as a stopped job would stop an estimate
+  {
+    static inline long batches_left{-1};
+    using material::henyey_greenstein::henyey_greenstein;
+    std::shared_ptr<material::base> clone() const override {
+      return std::make_shared<interrupting_material>(*this);
+    }
+    double asymmetry_factor() const {
+      if (batches_left-- == 0)
+	throw std::runtime_error("interrupted");
+      return material::henyey_greenstein::asymmetry_factor();
+    }
+  };
+
+  begin_test_case(single_layer_slab_test_N) {
+    using namespace flick;
+    // An estimate continued from its last checkpoint should equal an
+    // uninterrupted estimate, and a checkpoint of the estimate with
+    // another seed should not be continued
+    std::string file = (std::filesystem::temp_directory_path()
+			/ "single_layer_slab_test_N.bin").string();
+    auto run = [&](long batches, uint64_t seed = 3) {
+      model::single_layer_slab slab{thickness{1}};
+      slab.fill<interrupting_material>(absorption_coefficient{0},
+				       scattering_coefficient{1},
+				       asymmetry_factor{0});
+      slab.set_bottom(albedo{0});
+      slab.adjust_accuracy(percentage{3});
+      slab.set_threads(2);
+      slab.set_seed(seed);
+      slab.set_checkpoint(file, 1);
+      interrupting_material::batches_left = batches;
+      try {
+	double t = slab.hemispherical_transmittance();
+	return std::make_pair(t, slab.report().n_batches);
+      } catch (const std::runtime_error&) {
+	return std::make_pair(0.0, size_t{0});
+      }
+    };
+    auto full = run(-1);
+    std::filesystem::remove(file);
+    run(full.second/2);
+    check(std::filesystem::exists(file));
+    const long many = 1000;
+    check(run(many, 4) == std::make_pair(0.0, size_t{0}));
+    check(run(many) == full);
+    check(size_t(many - interrupting_material::batches_left) < full.second);
+    std::filesystem::remove(file);
+  } end_test_case()
+
+  begin_test_case(single_layer_slab_test_O) {
+    using namespace flick;
+    // Estimates added to one run should agree with separate
+    // estimates, each reaching its own accuracy
+    model::single_layer_slab slab{thickness{1}};
+    slab.fill<material::henyey_greenstein>(absorption_coefficient{0},
+					   scattering_coefficient{1},
+					   asymmetry_factor{0});
+    slab.set_bottom(albedo{0});
+    slab.set_seed(1);
+    slab.adjust_accuracy(percentage{2});
+    size_t r = slab.add_hemispherical_reflectance();
+    size_t t = slab.add_hemispherical_transmittance();
+    size_t u = slab.add_hemispherical_reflectance(unit_interval{0.5});
+    size_t l = slab.add_relative_radiance(polar_angle{0.5}, azimuth_angle{0},
+					  vertex_angle{0.3});
+    slab.adjust_accuracy(l, percentage{5});
+    check(slab.n_estimates() == 4);
+    std::vector<double> e = slab.estimate_all();
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p258-259, FLUX
+    check_close(e[r], 0.34133, 3);
+    check_close(e[t], 0.65867, 3);
+    check_close(e[r]+e[t], 1, 0.01);
+    for (size_t i=0; i<e.size(); ++i) {
+      check(slab.reports()[i].n_packages == slab.report().n_packages);
+      check(slab.reports()[i].accuracy < (i == l ? 0.05 : 0.02));
+    }
+    slab.adjust_accuracy(percentage{5});
+    check_close(e[u], slab.hemispherical_reflectance(unit_interval{0.5}), 5);
+    check_close(e[l], slab.relative_radiance(polar_angle{0.5}, azimuth_angle{0},
+					     vertex_angle{0.3}), 10);
+    slab.clear_estimates();
+    check_throw(slab.estimate_all());
+  } end_test_case()
+
+  begin_test_case(single_layer_slab_test_P) {
+    using namespace flick;
+    // Quasi-random batches should reach the accuracy with fewer
+    // packages
+    model::single_layer_slab slab{thickness{1}};
+    slab.fill<material::henyey_greenstein>(absorption_coefficient{0},
+					   scattering_coefficient{1},
+					   asymmetry_factor{0});
+    slab.set_bottom(albedo{0});
+    slab.set_seed(1);
+    slab.adjust_accuracy(percentage{1});
+    double plain = slab.hemispherical_reflectance();
+    size_t n_plain = slab.report().n_packages;
+    slab.use_quasi_random(16);
+    double quasi = slab.hemispherical_reflectance();
+    // van de Hulst 1980, vol 1, chapter 9, table 12, p258-259, FLUX
+    check_close(plain, 0.34133, 2);
+    check_close(quasi, 0.34133, 2);
+    check(slab.report().n_packages < n_plain);
+    slab.use_plane_parallel_kernel(true);
+    check_throw(slab.hemispherical_reflectance());
+    check_throw(slab.use_quasi_random(17));
+  } end_test_case()
 }
@@ -15,6 +15,13 @@ int main() {
   t.include<single_layer_slab_test_G>(); 
   t.include<single_layer_slab_test_H>(); 
   t.include<single_layer_slab_test_I>(); 
+  t.include<single_layer_slab_test_J>();
+  t.include<single_layer_slab_test_K>();
+  t.include<single_layer_slab_test_L>();
+  t.include<single_layer_slab_test_M>();
+  t.include<single_layer_slab_test_N>();
+  t.include<single_layer_slab_test_O>();
+  t.include<single_layer_slab_test_P>();
   t.run_test_cases();
   return 0;
 }
@@ -0,0 +1,34 @@
+#include "../environment/benchmark.hpp"
+#include "function.hpp"
+#include "uniform_random.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("numeric");
+  size_t n_points = 1000;
+  stdvec x = range(1,2,n_points).linspace();
+  stdvec y(n_points);
+  for (size_t i=0; i<n_points; ++i)
+    y[i] = exp(-x[i]);
+  pl_function pl{x,y};
+  pe_function pe{x,y};
+  uniform_random rnd(1);
+  size_t n_calls = 1000000;
+  stdvec readouts(n_calls);
+  for (auto& r : readouts)
+    r = rnd(1,2);
+  b.run("pl_function::value", [&]() {
+    double s = 0;
+    for (double r : readouts)
+      s += pl.value(r);
+    return s;
+  }, n_calls);
+  b.run("pe_function::value", [&]() {
+    double s = 0;
+    for (double r : readouts)
+      s += pe.value(r);
+    return s;
+  }, n_calls);
+  std::cout << b << std::endl;
+  return 0;
+}
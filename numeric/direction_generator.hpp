@@ -7,18 +7,30 @@
 
 namespace flick {
   class direction_generator {
-    uniform_random rnd;
+    uniform_random own_rnd_;
+    const uniform_random* rnd_{nullptr};
   public:
+    direction_generator() = default;
+    direction_generator(const uniform_random& rnd)
+    // Draw from given stream, which must outlive the generator
+      : rnd_{&rnd} {}
     unit_vector isotropic() const {
+      return isotropic(rnd());
+    }
+    unit_vector isotropic(const uniform_random& r) const {
       using namespace constants;
-      double phi = rnd(0,2*pi);
-      double theta = acos(rnd(-1,1));
+      double phi = r(0,2*pi);
+      double theta = acos(r(-1,1));
       return unit_vector{theta,phi};
     }
     unit_vector conic(double solid_angle, const unit_vector& cone_direction) const {
+      return conic(solid_angle, cone_direction, rnd());
+    }
+    unit_vector conic(double solid_angle, const unit_vector& cone_direction,
+		      const uniform_random& r) const {
       using namespace constants;
-      double phi = rnd(0,2*pi);
-      double theta = acos(rnd(1-solid_angle/(2*pi),1));
+      double phi = r(0,2*pi);
+      double theta = acos(r(1-solid_angle/(2*pi),1));
       pose p;
       p.rotate_to(cone_direction);
       p.rotate_about_local_z(phi);
@@ -26,15 +38,25 @@ namespace flick {
       return p.z_direction();
     }
     unit_vector lambertian(const unit_vector& surface_normal) const {
+      return lambertian(surface_normal, rnd());
+    }
+    unit_vector lambertian(const unit_vector& surface_normal,
+			   const uniform_random& r) const {
       using namespace constants;
-      double phi = rnd(0,2*pi);
-      double theta = asin(sqrt(rnd(0,1)));
+      double phi = r(0,2*pi);
+      double theta = asin(sqrt(r(0,1)));
       pose p;
       p.rotate_to(surface_normal);
       p.rotate_about_local_z(phi);
       p.rotate_about_local_y(theta);
       return p.z_direction();
     }
+  private:
+    const uniform_random& rnd() const {
+      if (rnd_ == nullptr)
+	return own_rnd_;
+      return *rnd_;
+    }
   };
 }
 #endif
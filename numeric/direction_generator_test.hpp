@@ -22,5 +22,11 @@ namespace flick {
     check(theta >= pi/2 && theta <= pi);
     check(phi >= 0 && theta <= 2*pi);
 
+    uniform_random rnd(1);
+    direction_generator dg1(rnd);
+    direction_generator dg2;
+    unit_vector d1 = dg1.isotropic();
+    unit_vector d2 = dg2.isotropic(uniform_random(1));
+    check_small(norm(d1-d2));
   } end_test_case()
 }
@@ -8,6 +8,7 @@
 #include <cmath>
 #include <memory>
 #include <stdexcept>
+#include <algorithm>
 #include "sorted_vector.hpp"
 #include "range.hpp"
 
@@ -191,7 +192,10 @@ namespace flick {
     std::string header_;
     sorted_vector xv_;
     stdvec yv_;
+    stdvec cumulative_;
+    bool is_increasing_{false};
   public:
+    using interpolation = I;
     sorted_vector xv2_;
     function() {
       xv_.set_step_type(I::get_step_type());
@@ -214,6 +218,7 @@ namespace flick {
     auto& clear() {
       xv_.clear();
       yv_.clear();
+      cumulative_.clear();
       return *this;
     }
     size_t size() const {
@@ -230,6 +235,7 @@ namespace flick {
       p = I::enforce_valid(p);
       xv_.append(p.x());
       yv_.emplace_back(p.y());
+      cumulative_.clear();
       return *this;
     }
     auto& append(const stdvec& xv, const stdvec& yv) {
@@ -242,17 +248,41 @@ namespace flick {
     auto& scale_x(double factor) {
       ensure(factor > 0);
       xv_.scale(factor);
+      cumulative_.clear();
       return *this;
     }   
     auto& scale_y(double factor) {
       for (size_t i=0; i<yv_.size(); ++i)
 	yv_[i] *= factor;
+      cumulative_.clear();
       return *this;
     }
     auto& normalize() {
       scale_y(1/integral());
       return *this;
     }
+    auto& precompute_integrals()
+    // Keeps the integral from the first point to each point, so that
+    // integral and integral_limit_b find their bins by binary search
+    // instead of walking through them. Dropped when the function
+    // changes.
+    {
+      cumulative_.clear();
+      if (xv_.size() < 2)
+	return *this;
+      cumulative_.resize(xv_.size());
+      cumulative_[0] = 0;
+      is_increasing_ = true;
+      for (size_t i=0; i < xv_.size()-1; ++i) {
+	double da = segment(i).integral(xv_[i], xv_[i+1]);
+	is_increasing_ = is_increasing_ && da >= 0;
+	cumulative_[i+1] = cumulative_[i] + da;
+      }
+      return *this;
+    }
+    bool has_precomputed_integrals() const {
+      return !cumulative_.empty();
+    }
     const stdvec& x() const {
       return xv_.all_values();
     }
@@ -276,18 +306,20 @@ namespace flick {
     }
     std::optional<double> integral_limit_b(double limit_a, double integral_value) const {
       ensure(yv_.size() > 1);
-      std::shared_ptr<sorted_vector::iterator> it;
+      if (has_precomputed_integrals() && is_increasing_)
+	return precomputed_integral_limit_b(limit_a, integral_value);
+      sorted_vector::ascending_iterator ascending(xv_);
+      sorted_vector::descending_iterator descending(xv_);
+      sorted_vector::iterator* it = &descending;
       if (integral_value > 0)
-	it = std::make_shared<sorted_vector::ascending_iterator>(xv_);
-      else
-	it = std::make_shared<sorted_vector::descending_iterator>(xv_);
+	it = &ascending;
       it->move_to_bin_at(limit_a);
       double area = 0;
       point p1;
       point p2;
       while(true) {
-	p1 = previous_point(it.get());
-	p2 = next_point(it.get());
+	p1 = previous_point(it);
+	p2 = next_point(it);
 	double next_area = I{p1,p2}.integral(limit_a, p2.x());
 	if(fabs(area + next_area) > fabs(integral_value) || it->is_in_end_bin())
 	  return I{p1,p2}.integral_limit_b(limit_a, integral_value-area);
@@ -301,20 +333,21 @@ namespace flick {
 	return 0;
       if (xv_.size()==1)
 	return yv_[0]*(limit_b-limit_a);
-      std::shared_ptr<sorted_vector::iterator> it;
+      if (has_precomputed_integrals())
+	return precomputed_integral(limit_a, limit_b);
+      sorted_vector::ascending_iterator ascending(xv_);
+      sorted_vector::descending_iterator descending(xv_);
+      sorted_vector::iterator* it = &descending;
       bool moving_right = (limit_a < limit_b); 
-      if (moving_right) {
-	it = std::make_shared<sorted_vector::ascending_iterator>(xv_);
-      } else {
-	it = std::make_shared<sorted_vector::descending_iterator>(xv_);
-      }
+      if (moving_right)
+	it = &ascending;
       it->move_to_bin_at(limit_a);
       double area = 0;
       point p1;
       point p2;
       while(true) {
-	p1 = previous_point(it.get());
-	p2 = next_point(it.get());
+	p1 = previous_point(it);
+	p2 = next_point(it);
 	bool outside = (p2.x() > limit_b);
 	if (not moving_right)
 	  outside = (p2.x() < limit_b); 
@@ -397,6 +430,59 @@ namespace flick {
       }
       return is;
     }
+    I segment(size_t n) const {
+      return I{point{xv_[n],yv_[n]}, point{xv_[n+1],yv_[n+1]}};
+    }
+    size_t bin_at(double x) const
+    // As sorted_vector::find, by binary search
+    {
+      const stdvec& xv = xv_.all_values();
+      auto it = std::upper_bound(xv.begin(), xv.end()-1, x);
+      if (it == xv.begin())
+	return 0;
+      return std::min<size_t>(it-xv.begin()-1, xv.size()-2);
+    }
+    double precomputed_integral(double limit_a, double limit_b) const {
+      if (limit_a > limit_b)
+	return -precomputed_integral(limit_b, limit_a);
+      size_t na = bin_at(limit_a);
+      size_t nb = bin_at(limit_b);
+      if (na == nb)
+	return segment(na).integral(limit_a, limit_b);
+      return segment(na).integral(limit_a, xv_[na+1])
+	+ (cumulative_[nb]-cumulative_[na+1])
+	+ segment(nb).integral(xv_[nb], limit_b);
+    }
+    std::optional<double> precomputed_integral_limit_b(double limit_a,
+						       double integral_value) const
+    // Same bins as when walking, found by binary search in the
+    // increasing cumulative integral
+    {
+      size_t na = bin_at(limit_a);
+      const stdvec& c = cumulative_;
+      if (integral_value > 0) {
+	double head = segment(na).integral(limit_a, xv_[na+1]);
+	if (head > integral_value || na == xv_.size()-2)
+	  return segment(na).integral_limit_b(limit_a, integral_value);
+	double target = c[na+1] + integral_value - head;
+	auto it = std::upper_bound(c.begin()+na+2, c.end()-1, target);
+	size_t m = it-c.begin()-1;
+	double area = head + c[m]-c[na+1];
+	return segment(m).integral_limit_b(xv_[m], integral_value-area);
+      }
+      point low{xv_[na],yv_[na]};
+      point high{xv_[na+1],yv_[na+1]};
+      double head = I{high,low}.integral(limit_a, xv_[na]);
+      if (fabs(head) > fabs(integral_value) || na == 0)
+	return I{high,low}.integral_limit_b(limit_a, integral_value);
+      double target = c[na] + integral_value - head;
+      auto it = std::lower_bound(c.begin(), c.begin()+na, target);
+      size_t m = (it == c.begin()) ? 0 : it-c.begin()-1;
+      double area = head - (c[na]-c[m+1]);
+      low = point{xv_[m],yv_[m]};
+      high = point{xv_[m+1],yv_[m+1]};
+      return I{high,low}.integral_limit_b(xv_[m+1], integral_value-area);
+    }
     point next_point(sorted_vector::iterator *it) const {
       return point{xv_[it->next_index()],yv_[it->next_index()]};
     }
@@ -273,4 +273,31 @@ namespace flick {
     pe_function f{{x1, x2},{y1,y2}};
     check_close(f.integral(a,b),(f.value(a)+f.value(b))/2*(b-a));
   } end_test_case()  
+
+  begin_test_case(function_test_K) {
+    // Precomputed integrals should agree with walking through the
+    // bins, also outside the end points
+    auto compare = [this](auto f) {
+      auto fp = f;
+      fp.precompute_integrals();
+      check(fp.has_precomputed_integrals());
+      std::vector<double> limits = {0.05, 0.3, 0.7, 1.7, 2.2, 3.3, 5, 7.9, 12};
+      for (double a : limits) {
+	for (double b : limits) {
+	  if (a == b)
+	    continue;
+	  double v = f.integral(a,b);
+	  check_close(fp.integral(a,b), v, 1e-9);
+	  check_close(*fp.integral_limit_b(a,v), *f.integral_limit_b(a,v), 1e-9);
+	}
+      }
+      f.scale_y(2);
+      check(!f.has_precomputed_integrals());
+    };
+    std::vector<double> x = {0.1, 0.5, 1, 2, 3, 4.5, 6, 8, 10};
+    std::vector<double> y = {2, 1.5, 3, 0.5, 0.2, 1, 4, 2, 0.3};
+    compare(pl_function{x,y});
+    compare(pe_function{x,y});
+    compare(pp_function{x,y});
+  } end_test_case()
 }
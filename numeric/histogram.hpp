@@ -5,6 +5,7 @@
 #include <vector>
 #include <iomanip>
 #include <fstream>
+#include "../environment/input_output.hpp"
 
 namespace flick {
   class equal_bins {
@@ -64,6 +65,16 @@ namespace flick {
 	os << '\n';
       }
     }
+    void write_state(std::ostream& os) const {
+      write_binary(os, h);
+    }
+    void read_state(std::istream& is) {
+      std::vector<std::vector<double>> r;
+      read_binary(is, r);
+      if (r.size() != h.size() || (!r.empty() && r[0].size() != h[0].size()))
+	throw std::runtime_error("histogram state");
+      h = r;
+    }
     friend std::ostream& operator<<(std::ostream &os, const histogram& h) {
       h.write(os);
       return os;
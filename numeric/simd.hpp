@@ -0,0 +1,105 @@
+#ifndef flick_simd
+#define flick_simd
+
+#include <cstdint>
+#include <limits>
+
+// Vector code is written with std::experimental::simd as found in
+// libstdc++. Compile with -DFLICK_SIMD=0 to leave it out, which is the
+// default with other standard libraries.
+#ifndef FLICK_SIMD
+#if defined(__GLIBCXX__) && __has_include(<experimental/simd>)
+#define FLICK_SIMD 1
+#else
+#define FLICK_SIMD 0
+#endif
+#endif
+
+namespace flick {
+  constexpr bool has_simd = FLICK_SIMD;
+}
+
+#if FLICK_SIMD
+#include <experimental/simd>
+
+namespace flick {
+namespace simd {
+  // As many doubles as fit in a register of the target, with integers
+  // of the same size for bit manipulation
+  using doubles = std::experimental::native_simd<double>;
+  using integers = std::experimental::rebind_simd_t<int64_t, doubles>;
+  constexpr size_t width = doubles::size();
+
+  inline integers as_integers(const doubles& x) {
+    return std::experimental::__proposed::simd_bit_cast<integers>(x);
+  }
+  inline doubles as_doubles(const integers& i) {
+    return std::experimental::__proposed::simd_bit_cast<doubles>(i);
+  }
+  inline doubles to_doubles(const integers& i)
+  // For magnitudes below 2^51
+  {
+    constexpr double shift = 0x1.8p52;
+    return as_doubles(i + as_integers(doubles(shift))) - shift;
+  }
+  inline integers to_integers(const doubles& x)
+  // Rounded to nearest, for magnitudes below 2^51
+  {
+    constexpr double shift = 0x1.8p52;
+    return as_integers(x + shift) - as_integers(doubles(shift));
+  }
+  inline doubles log(const doubles& x)
+  // Natural logarithm of positive normal numbers, with the reduction
+  // and polynomial of fdlibm's e_log.c, within one unit in the last
+  // place. The standard library computes it one element at a time.
+  {
+    integers bits = as_integers(x);
+    integers e = (bits - 0x3FE6A09E667F3BCD) >> 52;
+    doubles m = as_doubles(bits - (e << 52));
+    doubles f = m-1;
+    doubles s = f/(2+f);
+    doubles z = s*s;
+    doubles w = z*z;
+    doubles t1 = w*(3.999999999940941908e-01 + w*(2.222219843214978396e-01
+						  + w*1.531383769920937332e-01));
+    doubles t2 = z*(6.666666666666735130e-01 + w*(2.857142874366239149e-01
+						  + w*(1.818357216161805012e-01
+						       + w*1.479819860511658591e-01)));
+    doubles r = t1+t2;
+    doubles hfsq = 0.5*f*f;
+    doubles k = to_doubles(e);
+    return k*6.93147180369123816490e-01
+      - ((hfsq - (s*(hfsq+r) + k*1.90821492927058770002e-10)) - f);
+  }
+  inline doubles exp(const doubles& x)
+  // Exponential with the reduction and polynomial of fdlibm's e_exp.c,
+  // within one unit in the last place. Results below the smallest
+  // normal number are flushed to zero.
+  {
+    doubles y = std::experimental::min(std::experimental::max(x, doubles(-708.0)),
+				       doubles(709.0));
+    constexpr double shift = 0x1.8p52;
+    doubles kd = y*1.44269504088896338700e+00 + shift;
+    integers k = as_integers(kd) - as_integers(doubles(shift));
+    kd -= shift;
+    doubles hi = y - kd*6.93147180369123816490e-01;
+    doubles lo = kd*1.90821492927058770002e-10;
+    doubles r = hi-lo;
+    doubles t = r*r;
+    doubles c = r - t*(1.66666666666666019037e-01
+		       + t*(-2.77777777770155933842e-03
+			    + t*(6.61375632143793436117e-05
+				 + t*(-1.65339022054652515390e-06
+				      + t*4.13813679705723846039e-08))));
+    doubles e = 1 - ((lo - (r*c)/(2-c)) - hi);
+    doubles scale = as_doubles((k + 1023) << 52);
+    e *= scale;
+    where(x < -708.0, e) = 0;
+    where(x > 709.0, e) = std::numeric_limits<double>::infinity();
+    return e;
+  }
+}
+}
+#endif
+
+#endif
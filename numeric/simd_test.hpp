@@ -0,0 +1,28 @@
+#include "simd.hpp"
+
+namespace flick {
+  begin_test_case(simd_test) {
+#if FLICK_SIMD
+    // Logarithm and exponential agree with the standard library to a
+    // few units in the last place
+    double x0 = 1e-300;
+    while (x0 < 1e300) {
+      simd::doubles x([&](auto i) { return x0*(1+0.37*i); });
+      simd::doubles y = simd::log(x);
+      for (size_t i=0; i<simd::width; ++i)
+	check_close(y[i], log(x[i]), 1e-11);
+      x0 *= 7.3;
+    }
+    for (double x0=-700; x0<700; x0+=0.93) {
+      simd::doubles x([&](auto i) { return x0+0.11*i; });
+      simd::doubles y = simd::exp(x);
+      for (size_t i=0; i<simd::width; ++i)
+	check_close(y[i], exp(x[i]), 1e-11);
+    }
+    simd::doubles y = simd::exp(simd::doubles(-800));
+    check(y[0] == 0);
+    simd::doubles k = simd::to_doubles(simd::to_integers(simd::doubles(-2.7)));
+    check(k[0] == -3);
+#endif
+  } end_test_case()
+}
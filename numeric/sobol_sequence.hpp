@@ -0,0 +1,142 @@
+#ifndef flick_sobol_sequence
+#define flick_sobol_sequence
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "uniform_random.hpp"
+
+namespace flick {
+  class sobol_sequence
+  // Owen-scrambled Sobol points in the open unit cube, with direction
+  // numbers from Joe and Kuo 2008, Constructing Sobol sequences with
+  // better two-dimensional projections. Scrambling follows Burley
+  // 2020, Practical hash-based Owen scrambling, with one hashed seed
+  // per dimension. Each scrambling seed gives an independent
+  // randomization in which every point is uniformly distributed, so
+  // that estimates are unbiased and their spread over randomizations
+  // measures their error. Points are numbered with 64 bits, and each
+  // block of 2^32 points, as many as the sequence has, is scrambled
+  // anew.
+  {
+    static constexpr size_t n_bits = 32;
+    std::vector<std::array<uint32_t,n_bits>> directions_;
+    std::vector<uint32_t> seeds_;
+    uint64_t seed_{0};
+    uint64_t block_{0};
+  public:
+    static constexpr size_t max_dimensions = 16;
+    sobol_sequence(size_t n_dimensions, uint64_t seed = 0) {
+      if (n_dimensions < 1 || n_dimensions > max_dimensions)
+	throw std::runtime_error("sobol_sequence dimensions");
+      directions_.resize(n_dimensions);
+      for (size_t d=0; d<n_dimensions; ++d)
+	directions_[d] = direction_numbers(d);
+      randomize(seed);
+    }
+    size_t n_dimensions() const {
+      return directions_.size();
+    }
+    void randomize(uint64_t seed)
+    // Independent scrambling for each seed
+    {
+      seed_ = seed;
+      scramble(0);
+    }
+    double operator()(uint32_t index, size_t dimension) const
+    // Coordinate of a point in the current block
+    {
+      uint32_t x = 0;
+      const std::array<uint32_t,n_bits>& v = directions_[dimension];
+      for (size_t k=0; index != 0; index >>= 1, ++k)
+	if (index & 1)
+	  x ^= v[k];
+      x = owen_scramble(x, seeds_[dimension]);
+      return (x + 0.5)*0x1.0p-32;
+    }
+    std::vector<double> point(uint64_t index) {
+      uint64_t block = index >> n_bits;
+      if (block != block_)
+	scramble(block);
+      std::vector<double> p(directions_.size());
+      for (size_t d=0; d<p.size(); ++d)
+	p[d] = (*this)(static_cast<uint32_t>(index), d);
+      return p;
+    }
+  private:
+    void scramble(uint64_t block) {
+      seeds_.resize(directions_.size());
+      philox::key k = {static_cast<uint32_t>(seed_), static_cast<uint32_t>(seed_ >> 32)};
+      for (size_t d=0; d<seeds_.size(); ++d)
+	seeds_[d] = philox::generate({static_cast<uint32_t>(d),0,
+	    static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32)}, k)[0];
+      block_ = block;
+    }
+    static std::array<uint32_t,n_bits> direction_numbers(size_t dimension)
+    // The first dimension is the van der Corput sequence. Others
+    // follow from the degree s, coefficients a and initial numbers m
+    // of their primitive polynomials.
+    {
+      struct polynomial {
+	uint32_t s;
+	uint32_t a;
+	std::array<uint32_t,6> m;
+      };
+      static constexpr std::array<polynomial,max_dimensions-1> polynomials = {{
+	  {1, 0, {1}},
+	  {2, 1, {1,3}},
+	  {3, 1, {1,3,1}},
+	  {3, 2, {1,1,1}},
+	  {4, 1, {1,1,3,3}},
+	  {4, 4, {1,3,5,13}},
+	  {5, 2, {1,1,5,5,17}},
+	  {5, 4, {1,1,5,5,5}},
+	  {5, 7, {1,1,7,11,19}},
+	  {5, 11, {1,1,5,1,1}},
+	  {5, 13, {1,1,1,3,11}},
+	  {5, 14, {1,3,5,5,31}},
+	  {6, 1, {1,3,3,9,7,49}},
+	  {6, 13, {1,1,1,15,21,21}},
+	  {6, 16, {1,3,1,13,27,49}}}};
+      std::array<uint32_t,n_bits> v;
+      if (dimension == 0) {
+	for (size_t k=0; k<n_bits; ++k)
+	  v[k] = uint32_t{1} << (n_bits-1-k);
+	return v;
+      }
+      const polynomial& p = polynomials[dimension-1];
+      for (size_t k=0; k<p.s; ++k)
+	v[k] = p.m[k] << (n_bits-1-k);
+      for (size_t k=p.s; k<n_bits; ++k) {
+	v[k] = v[k-p.s] ^ (v[k-p.s] >> p.s);
+	for (size_t j=1; j<p.s; ++j)
+	  if ((p.a >> (p.s-1-j)) & 1)
+	    v[k] ^= v[k-j];
+      }
+      return v;
+    }
+    static uint32_t reverse_bits(uint32_t x) {
+      x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+      x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+      x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+      x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+      return (x >> 16) | (x << 16);
+    }
+    static uint32_t owen_scramble(uint32_t x, uint32_t seed)
+    // Flips each bit depending on the bits above it, through a hash
+    // that only lets lower bits affect higher ones, applied to the
+    // reversed bits
+    {
+      x = reverse_bits(x);
+      x += seed;
+      x ^= x*0x6c50b47c;
+      x ^= x*0xb82f1e52;
+      x ^= x*0xc7afe638;
+      x ^= x*0x8d22f6e6;
+      return reverse_bits(x);
+    }
+  };
+}
+
+#endif
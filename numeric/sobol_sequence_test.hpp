@@ -0,0 +1,53 @@
+#include "sobol_sequence.hpp"
+
+namespace flick {
+  begin_test_case(sobol_sequence_test) {
+    size_t m = 10;
+    size_t n = size_t{1} << m;
+    sobol_sequence s(sobol_sequence::max_dimensions, 3);
+    for (size_t d=0; d<s.n_dimensions(); ++d) {
+      std::vector<size_t> strata(n, 0);
+      for (size_t i=0; i<n; ++i) {
+	double x = s(i, d);
+	check(x > 0 && x < 1);
+	strata[size_t(x*n)]++;
+      }
+      check(std::all_of(strata.begin(), strata.end(),
+			[](size_t c) { return c == 1; }));
+    }
+    for (size_t k=0; k<=m; ++k) {
+      std::vector<size_t> boxes(n, 0);
+      size_t nx = size_t{1} << k;
+      size_t ny = n/nx;
+      for (size_t i=0; i<n; ++i)
+	boxes[size_t(s(i,0)*nx)*ny + size_t(s(i,1)*ny)]++;
+      check(std::all_of(boxes.begin(), boxes.end(),
+			[](size_t c) { return c == 1; }));
+    }
+    double sum = 0;
+    for (size_t i=0; i<n; ++i) {
+      std::vector<double> p = s.point(i);
+      double f = 1;
+      for (double x : p)
+	f *= 1+(x-0.5)/2;
+      sum += f;
+    }
+    check_close(sum/n, 1, 0.05_pct);
+    sobol_sequence s2(2, 4);
+    check(s2(0,0) != s(0,0));
+    double mean = 0;
+    size_t n_seeds = 10000;
+    for (size_t i=0; i<n_seeds; ++i) {
+      s2.randomize(i);
+      mean += s2(5,1);
+    }
+    check_close(mean/n_seeds, 0.5, 1.0_pct);
+    uint64_t block = uint64_t{1} << 32;
+    std::vector<double> p0 = s2.point(5);
+    std::vector<double> p1 = s2.point(block+5);
+    check(p1 != p0);
+    check(s2.point(5) == p0);
+    check(s2.point(2*block+5) != p1);
+    check_throw(sobol_sequence(sobol_sequence::max_dimensions+1));
+  } end_test_case()
+}
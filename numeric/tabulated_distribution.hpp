@@ -0,0 +1,92 @@
+#ifndef flick_tabulated_distribution
+#define flick_tabulated_distribution
+
+#include <algorithm>
+#include "function.hpp"
+
+namespace flick {
+  class tabulated_distribution
+  // Piecewise linear density through given points. A guide table
+  // with one entry per point finds the segment of a quantile in O(1)
+  // on average, and the quantile is exact within the segment.
+  {
+    stdvec x_;
+    stdvec y_;
+    stdvec cdf_;
+    std::vector<size_t> guide_;
+    double mean_{0};
+  public:
+    tabulated_distribution() = default;
+    tabulated_distribution(const stdvec& x, const stdvec& y)
+      : x_{x}, y_{y}, cdf_(x.size(),0.0), guide_(x.size()) {
+      ensure(x.size() > 1 && x.size() == y.size());
+      for (size_t i=1; i<x_.size(); ++i) {
+	ensure(x_[i] > x_[i-1] && y_[i] >= 0);
+	cdf_[i] = cdf_[i-1] + 0.5*(y_[i-1]+y_[i])*(x_[i]-x_[i-1]);
+      }
+      ensure(cdf_.back() > 0);
+      for (size_t i=0; i<x_.size(); ++i) {
+	y_[i] /= cdf_.back();
+	cdf_[i] /= cdf_.back();
+      }
+      size_t j = 0;
+      for (size_t i=0; i<guide_.size(); ++i) {
+	double p = double(i)/guide_.size();
+	while (cdf_[j+1] <= p && j+2 < x_.size())
+	  ++j;
+	guide_[i] = j;
+      }
+      for (size_t i=1; i<x_.size(); ++i)
+	mean_ += (x_[i]-x_[i-1])*(y_[i-1]*(2*x_[i-1]+x_[i])
+				  + y_[i]*(x_[i-1]+2*x_[i]))/6;
+    }
+    bool empty() const {
+      return x_.empty();
+    }
+    double mean() const {
+      return mean_;
+    }
+    double pdf(double x) const {
+      if (x < x_.front() || x > x_.back())
+	return 0;
+      size_t i = segment(x);
+      return y_[i] + (y_[i+1]-y_[i])*(x-x_[i])/(x_[i+1]-x_[i]);
+    }
+    double cdf(double x) const {
+      if (x <= x_.front())
+	return 0;
+      if (x >= x_.back())
+	return 1;
+      size_t i = segment(x);
+      return cdf_[i] + 0.5*(y_[i]+pdf(x))*(x-x_[i]);
+    }
+    double quantile(double p) const {
+      return quantile_and_pdf(p).x();
+    }
+    point quantile_and_pdf(double p) const
+    // Quantile x at p and density at x
+    {
+      size_t i = guide_[std::min<size_t>(p*guide_.size(), guide_.size()-1)];
+      while (cdf_[i+1] < p && i+2 < x_.size())
+	++i;
+      double w = x_[i+1]-x_[i];
+      double slope = (y_[i+1]-y_[i])/w;
+      double r = std::max(p-cdf_[i], 0.0);
+      double root = sqrt(std::max(y_[i]*y_[i] + 2*slope*r, 0.0));
+      double dx = 0;
+      if (y_[i] + root > 0)
+	dx = std::clamp(2*r/(y_[i] + root), 0.0, w);
+      return {x_[i]+dx, y_[i]+slope*dx};
+    }
+  private:
+    size_t segment(double x) const {
+      return std::upper_bound(x_.begin(), x_.end()-1, x) - x_.begin() - 1;
+    }
+    void ensure(bool b) const {
+      if (!b)
+	throw std::runtime_error("numeric tabulated_distribution");
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include "tabulated_distribution.hpp"
+
+namespace flick {
+  begin_test_case(tabulated_distribution_test) {
+    tabulated_distribution t({0,0.1,0.5,1},{0,0.1,0.5,1});
+    check_close(t.cdf(0.5),0.25);
+    check_close(t.pdf(0.75),1.5);
+    check_close(t.mean(),2.0/3);
+    check_close(t.quantile(0.25),0.5);
+    check_close(t.quantile(0.5),sqrt(0.5));
+    check_close(t.quantile(1),1);
+    check_small(t.quantile(0));
+    point p = t.quantile_and_pdf(0.81);
+    check_close(p.x(),0.9);
+    check_close(p.y(),1.8);
+    check_throw(tabulated_distribution({0,1},{0,0}));
+  } end_test_case()
+}
@@ -1,4 +1,5 @@
 #include "../environment/unit_test.hpp"
+#include "uniform_random_test.hpp"
 #include "direction_generator_test.hpp"
 #include "vector_test.hpp"
 #include "histogram_test.hpp"
@@ -10,7 +11,10 @@
 #include "table_test.hpp"
 #include "flist_test.hpp"
 #include "distribution_test.hpp"
+#include "tabulated_distribution_test.hpp"
 #include "value_collection_test.hpp"
+#include "sobol_sequence_test.hpp"
+#include "simd_test.hpp"
 
 int main() {
   using namespace flick;
@@ -26,6 +30,9 @@ int main() {
   t.include<function_test_H>(); 
   t.include<function_test_I>();
   t.include<function_test_J>();
+  t.include<function_test_K>();
+  t.include<uniform_random_test_A>();
+  t.include<uniform_random_test_B>();
   t.include<direction_generator_test>();
   t.include<vector_test>();
   t.include<histogram_test>();
@@ -39,7 +46,10 @@ int main() {
   t.include<distribution_test_A>();
   t.include<distribution_test_B>();
   t.include<distribution_test_C>();
+  t.include<tabulated_distribution_test>();
   t.include<value_collection_test>();
+  t.include<sobol_sequence_test>();
+  t.include<simd_test>();
   t.run_test_cases();
   return 0;
 } 
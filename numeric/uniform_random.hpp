@@ -1,24 +1,218 @@
 #ifndef flick_uniform_random
 #define flick_uniform_random
 
-#include <random>
+#include <array>
+#include <vector>
 #include <chrono>
+#include <cstdint>
+#include <bit>
+#include "../environment/input_output.hpp"
 
 namespace flick {
-  class uniform_random {
-    mutable std::default_random_engine generator;
-    mutable std::uniform_real_distribution<double> distribution;
+  class philox
+  // Counter-based Philox-4x32-10 generator, see Salmon et al. 2011,
+  // Parallel random numbers: as easy as 1, 2, 3. Each counter value
+  // maps to four independent 32-bit words for a given key.
+  {
   public:
-    uniform_random()
-    : distribution{std::uniform_real_distribution<double>(0,1)} {
-      unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-      generator = std::default_random_engine(seed);
+    using block = std::array<uint32_t,4>;
+    using key = std::array<uint32_t,2>;
+    static block generate(block ctr, key k) {
+      for (size_t i=0; i<9; ++i) {
+	ctr = round(ctr, k);
+	k[0] += 0x9E3779B9;
+	k[1] += 0xBB67AE85;
+      }
+      return round(ctr, k);
+    }
+    template<size_t N>
+    static void generate(std::array<uint32_t,N>& c0, std::array<uint32_t,N>& c1,
+			 std::array<uint32_t,N>& c2, std::array<uint32_t,N>& c3,
+			 key k)
+    // Interleaved generation of N blocks stored word by word, written
+    // as plain loops over the blocks so that the compiler can
+    // vectorize them
+    {
+      for (size_t i=0; i<10; ++i) {
+	for (size_t j=0; j<N; ++j) {
+	  uint64_t p0 = uint64_t{0xD2511F53}*c0[j];
+	  uint64_t p1 = uint64_t{0xCD9E8D57}*c2[j];
+	  c0[j] = static_cast<uint32_t>(p1 >> 32)^c1[j]^k[0];
+	  c1[j] = static_cast<uint32_t>(p1);
+	  c2[j] = static_cast<uint32_t>(p0 >> 32)^c3[j]^k[1];
+	  c3[j] = static_cast<uint32_t>(p0);
+	}
+	k[0] += 0x9E3779B9;
+	k[1] += 0xBB67AE85;
+      }
+    }
+  private:
+    static block round(const block& c, const key& k) {
+      uint64_t p0 = uint64_t{0xD2511F53}*c[0];
+      uint64_t p1 = uint64_t{0xCD9E8D57}*c[2];
+      uint32_t hi0 = p0 >> 32;
+      uint32_t lo0 = p0;
+      uint32_t hi1 = p1 >> 32;
+      uint32_t lo1 = p1;
+      return {hi1^c[1]^k[0], lo1, hi0^c[3]^k[1], lo0};
+    }
+  };
+
+  class uniform_random
+  // Uniform random numbers in the open interval (0,1). Number n in
+  // stream s for a given seed is found directly from counter {n/2, s},
+  // which allows jumping ahead and splitting into non-overlapping
+  // streams at no cost. Numbers given to lead_with are returned
+  // before the stream continues.
+  {
+    philox::key key_;
+    uint64_t stream_{0};
+    mutable uint64_t counter_{0};
+    mutable std::array<double,2> buffer_{};
+    mutable size_t buffered_{0};
+    std::vector<double> leading_;
+    mutable size_t n_led_{0};
+  public:
+    uniform_random() {
+      uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+      key_ = to_key(seed);
+    }
+    explicit uniform_random(uint64_t seed, uint64_t stream=0)
+      : key_{to_key(seed)}, stream_{stream} {
     }
     double operator()() const {
-      return distribution(generator);
+      if (n_led_ < leading_.size())
+	return leading_[n_led_++];
+      if (buffered_ == 0)
+	refill();
+      return buffer_[2-buffered_--];
     }
     double operator()(double min, double max) const {
-      return min + distribution(generator)*(max-min);
+      return min + (*this)()*(max-min);
+    }
+    void fill(std::vector<double>& v) const
+    // Fills v with the same numbers as repeated calls would give,
+    // generating two numbers for each counter value.
+    {
+      size_t i = 0;
+      while ((n_led_ < leading_.size() || buffered_ > 0) && i < v.size())
+	v[i++] = (*this)();
+      constexpr size_t n = 32;
+      std::array<uint32_t,n> c0, c1, c2, c3;
+      for (; i+2*n <= v.size(); i += 2*n) {
+	for (size_t j=0; j<n; ++j) {
+	  c0[j] = static_cast<uint32_t>(counter_+j);
+	  c1[j] = static_cast<uint32_t>((counter_+j) >> 32);
+	  c2[j] = static_cast<uint32_t>(stream_);
+	  c3[j] = static_cast<uint32_t>(stream_ >> 32);
+	}
+	counter_ += n;
+	philox::generate(c0, c1, c2, c3, key_);
+	for (size_t j=0; j<n; ++j) {
+	  v[i+2*j] = to_unit_interval(c0[j], c1[j]);
+	  v[i+2*j+1] = to_unit_interval(c2[j], c3[j]);
+	}
+      }
+      for (; i+1 < v.size(); i += 2) {
+	philox::block b = philox::generate(next_counter(), key_);
+	v[i] = to_unit_interval(b[0], b[1]);
+	v[i+1] = to_unit_interval(b[2], b[3]);
+      }
+      if (i < v.size())
+	v[i] = (*this)();
+    }
+    std::vector<double> operator()(size_t n) const {
+      std::vector<double> v(n);
+      fill(v);
+      return v;
+    }
+    void lead_with(const std::vector<double>& numbers)
+    // The next numbers drawn, such as coordinates of a quasi-random
+    // point, in place of any not yet drawn from an earlier call. The
+    // stream is not advanced by them.
+    {
+      leading_ = numbers;
+      n_led_ = 0;
+    }
+    uniform_random& discard(uint64_t n)
+    // Jump n numbers ahead in the current stream. Leading numbers
+    // are not skipped and are still drawn first.
+    {
+      uint64_t skip = std::min<uint64_t>(n, buffered_);
+      buffered_ -= skip;
+      n -= skip;
+      counter_ += n/2;
+      if (n%2 == 1) {
+	refill();
+	buffered_--;
+      }
+      return *this;
+    }
+    uniform_random stream(uint64_t n) const
+    // Independent stream n with the same seed, starting from its
+    // beginning.
+    {
+      uniform_random r = *this;
+      r.stream_ = n;
+      r.counter_ = 0;
+      r.buffered_ = 0;
+      r.leading_.clear();
+      r.n_led_ = 0;
+      return r;
+    }
+    uint64_t seed() const {
+      return uint64_t{key_[1]} << 32 | key_[0];
+    }
+    uint64_t stream_number() const {
+      return stream_;
+    }
+    uint64_t position() const
+    // Number of random numbers drawn from current stream
+    {
+      return 2*counter_ - buffered_;
+    }
+    void write_state(std::ostream& os) const {
+      write_binary(os, key_);
+      write_binary(os, stream_);
+      write_binary(os, counter_);
+      write_binary(os, buffer_);
+      write_binary(os, buffered_);
+      write_binary(os, leading_);
+      write_binary(os, n_led_);
+    }
+    void read_state(std::istream& is) {
+      read_binary(is, key_);
+      read_binary(is, stream_);
+      read_binary(is, counter_);
+      read_binary(is, buffer_);
+      read_binary(is, buffered_);
+      read_binary(is, leading_);
+      read_binary(is, n_led_);
+    }
+  private:
+    static philox::key to_key(uint64_t seed) {
+      return {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    }
+    static double to_unit_interval(uint32_t a, uint32_t b)
+    // 52 random mantissa bits give a number in [1,2), which is
+    // shifted to the middle of its interval in (0,1)
+    {
+      uint64_t u = (uint64_t{a} << 32 | b) >> 12;
+      return std::bit_cast<double>(u | 0x3FF0000000000000) - (1-0x1.0p-53);
+    }
+    philox::block next_counter() const {
+      philox::block c = {static_cast<uint32_t>(counter_),
+	static_cast<uint32_t>(counter_ >> 32),
+	static_cast<uint32_t>(stream_),
+	static_cast<uint32_t>(stream_ >> 32)};
+      counter_++;
+      return c;
+    }
+    void refill() const {
+      philox::block b = philox::generate(next_counter(), key_);
+      buffer_[0] = to_unit_interval(b[0], b[1]);
+      buffer_[1] = to_unit_interval(b[2], b[3]);
+      buffered_ = 2;
     }
   };
 }
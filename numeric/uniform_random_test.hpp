@@ -0,0 +1,46 @@
+#include "uniform_random.hpp"
+
+namespace flick {
+  begin_test_case(uniform_random_test_A) {
+    // Known-answer tests from the Random123 library
+    philox::block b = philox::generate({0,0,0,0},{0,0});
+    check(b == philox::block{0x6627e8d5,0xe169c58d,0xbc57ac4c,0x9b00dbd8});
+    b = philox::generate({0xffffffff,0xffffffff,0xffffffff,0xffffffff},
+			 {0xffffffff,0xffffffff});
+    check(b == philox::block{0x408f276d,0x41c83b0e,0xa20bc7c6,0x6d5451fd});
+    b = philox::generate({0x243f6a88,0x85a308d3,0x13198a2e,0x03707344},
+			 {0xa4093822,0x299f31d0});
+    check(b == philox::block{0xd16cfe09,0x94fdcceb,0x5001e420,0x24126ea1});
+  } end_test_case()
+
+  begin_test_case(uniform_random_test_B) {
+    uniform_random r1(7);
+    uniform_random r2(7);
+    std::vector<double> v(101);
+    for (size_t i=0; i<v.size(); ++i)
+      v[i] = r1();
+    check(r2() == v[0]);
+    r2.discard(50);
+    check(r2() == v[51]);
+    check(r2.position() == 52);
+    std::vector<double> w(49);
+    r2.fill(w);
+    check(w.front() == v[52] && w.back() == v[100]);
+    uniform_random r3 = r1.stream(1);
+    check(r3() != uniform_random(7)());
+    check(r3.stream_number() == 1);
+    uniform_random r4(7);
+    r4.lead_with({0.25,0.75});
+    std::vector<double> x(4);
+    r4.fill(x);
+    check(x[0] == 0.25 && x[1] == 0.75 && x[2] == v[0] && x[3] == v[1]);
+    double sum = 0;
+    size_t n = 100000;
+    std::vector<double> u = uniform_random(1)(n);
+    for (size_t i=0; i<n; ++i) {
+      check(u[i] > 0 && u[i] < 1);
+      sum += u[i];
+    }
+    check_close(sum/n, 0.5, 1.0_pct);
+  } end_test_case()
+}
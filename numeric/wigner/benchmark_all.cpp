@@ -0,0 +1,17 @@
+#include "../../environment/benchmark.hpp"
+#include "wigner_fit.hpp"
+#include "../physics_function.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("wigner");
+  auto f = henyey_greenstein(0.9);
+  for (size_t n_terms : {16, 64}) {
+    b.run("wigner_fit_"+std::to_string(n_terms)+"_terms", [&]() {
+      wigner_fit wf(f,0,0,n_terms,fit::relative);
+      return wf.coefficients().at(0);
+    });
+  }
+  std::cout << b << std::endl;
+  return 0;
+}
@@ -6,14 +6,21 @@
 
 namespace flick {
   stokes operator*(const mueller& m, const stokes& s)
-  // sparse matrix and vector multiplication
+  // Matrix and vector multiplication, with fewer operations for
+  // block-diagonal matrices
   {
-    std::vector<double> s1 = {s.I(),s.Q(),s.U(),s.V()};
-    std::vector<double> s2 = {0,0,0,0};
-    for (size_t n = 0; n < m.size(); ++n) {
-      s2[m(n).row] += m(n).value * s1[m(n).col];
-    }
-    return stokes(s2);
+    const std::array<double,16>& a = m.elements();
+    double I = s.I();
+    double Q = s.Q();
+    double U = s.U();
+    double V = s.V();
+    if (m.is_block_diagonal())
+      return stokes{a[0]*I + a[1]*Q, a[4]*I + a[5]*Q,
+		    a[10]*U + a[11]*V, a[14]*U + a[15]*V};
+    return stokes{a[0]*I + a[1]*Q + a[2]*U + a[3]*V,
+		  a[4]*I + a[5]*Q + a[6]*U + a[7]*V,
+		  a[8]*I + a[9]*Q + a[10]*U + a[11]*V,
+		  a[12]*I + a[13]*Q + a[14]*U + a[15]*V};
   }
 }
 
@@ -13,6 +13,14 @@ namespace flick {
     m.add(1,0,1);
     stokes s1 = stokes{1,1,0,0};
     stokes s2 = m * s1;
+    check(m.is_block_diagonal());
+    check_close(s2.I(),2);
+    check_close(s2.Q(),1);
+    m.add(0,3,2).add(3,3,1);
+    check(!m.is_block_diagonal());
+    stokes s2v = m * stokes{1,1,0,1};
+    check_close(s2v.I(),4);
+    check_close(s2v.V(),1);
     
     mueller im = isotropic_mueller();
     stokes s3(1,0,0,0);
@@ -1,5 +1,7 @@
 #ifndef flick_mueller
 #define flick_mueller
+#include <array>
+#include <cstdint>
 #include "../numeric/function.hpp"
 #include "../numeric/physics_function.hpp"
 #include "../numeric/std_operators.hpp"
@@ -7,33 +9,57 @@
 
 namespace flick {
   class mueller
-  // Holds non-zero Mueller matrix element values for one angle
+  // 4x4 Mueller matrix for one angle. Values are kept in a fixed
+  // array, and non-zero elements are listed in the order they were
+  // added, so that neither copies nor products allocate.
   {
     struct element {
       size_t row;
       size_t col;
       double value;
     };
-    std::vector<element> elements_;
+    std::array<double,16> m_{};
+    std::array<element,16> elements_;
+    size_t n_elements_{0};
+    uint16_t non_zero_{0};
+    static constexpr uint16_t block_diagonal_ = 0xCC33;
   public:
-     mueller& add(size_t row, size_t col, double value) {
-      elements_.push_back(element{row,col,value});
+    mueller& add(size_t row, size_t col, double value) {
+      size_t i = 4*row + col;
+      if (row > 3 || col > 3)
+	throw std::runtime_error("mueller");
+      if (non_zero_ & (1 << i)) {
+	for (size_t n = 0; n < n_elements_; ++n)
+	  if (elements_[n].row == row && elements_[n].col == col)
+	    elements_[n].value += value;
+      } else {
+	elements_[n_elements_++] = element{row,col,value};
+	non_zero_ |= (1 << i);
+      }
+      m_[i] += value;
       return *this;
     }
     size_t size() const {
-      return elements_.size();
+      return n_elements_;
     }
     const element& operator()(size_t n) const {
-      return elements_.at(n);
+      if (n >= n_elements_)
+	throw std::out_of_range("mueller");
+      return elements_[n];
     }
     double value(size_t row, size_t col) const {
-      auto& e = elements_;
-      for (size_t n = 0; n < e.size(); ++n) {
-	if (e[n].row == row && e[n].col == col) {
-	  return e[n].value;
-	}
-      }
-      return 0;
+      return m_[4*row + col];
+    }
+    bool is_block_diagonal() const
+    // Only upper left and lower right 2x2 blocks are non-zero, as for
+    // Fresnel, Rayleigh and Mie matrices
+    {
+      return (non_zero_ & ~block_diagonal_) == 0;
+    }
+    const std::array<double,16>& elements() const
+    // Row-major values
+    {
+      return m_;
     }
   };
 
@@ -1,19 +1,24 @@
 #ifndef flick_stokes
 #define flick_stokes
 
+#include <array>
+#include <vector>
+#include <algorithm>
 #include "../numeric/constants.hpp"
 
 namespace flick {
   class stokes
-  // see Wikipedia Stokes parameters
+  // see Wikipedia Stokes parameters. Elements are kept in a fixed
+  // array, so that copies do not allocate.
   {
-    std::vector<double> s_{1,0,0,0};
+    std::array<double,4> s_{1,0,0,0};
   public:
     stokes() = default;
     stokes(double s0, double s1, double s2, double s3)
       : s_{s0,s1,s2,s3} {};
-    stokes(const std::vector<double>& s) : s_{s} {
+    stokes(const std::vector<double>& s) {
       ensure(s.size()==4);
+      std::copy(s.begin(), s.end(), s_.begin());
     }
     static stokes polarization_ellipse(double intensity, double rotation_angle,
 	   double eccentricity_angle, double degree_of_polarization) {
@@ -39,7 +44,7 @@ namespace flick {
       return stokes{1,0,0,-1};
     }
     static stokes rhc_polarized() {
-      return stokes{{1,0,0,1}};
+      return stokes{1,0,0,1};
     }
     double operator()(size_t element_number) {
       return s_.at(element_number);
@@ -58,8 +63,8 @@ namespace flick {
       return *this;
     }
     stokes& scale(double factor) {
-      for (size_t i=0; i<s_.size(); ++i)
-	s_[i] *= factor;
+      for (auto& s : s_)
+	s *= factor;
       return *this;
     }
     double rotation_angle() const {
@@ -0,0 +1,37 @@
+#include "../environment/benchmark.hpp"
+#include "ordinary_mc.hpp"
+#include "../material/henyey_greenstein.hpp"
+
+int main() {
+  using namespace flick;
+  benchmark b("transporter");
+  b.repetitions(1,5);
+  for (size_t m : {2, 4, 8, 10}) {
+    // Packages followed through a container with m^3 embedded spheres
+    // of its own material, found through the bounding volume
+    // hierarchy
+    size_t n_spheres = m*m*m;
+    sphere container(160);
+    container.name("container");
+    container().fill<material::henyey_greenstein>(0.001,0.05,0.8);
+    container().outward_receiver().activate();
+    double step = 180.0/m;
+    for (size_t i=0; i<n_spheres; ++i) {
+      sphere s(0.3*step);
+      s.move_by({-90+step*(i%m+0.5), -90+step*(i/m%m+0.5), -90+step*(i/m/m+0.5)});
+      s().fill<material::henyey_greenstein>(0.001,0.05,0.8);
+      container.insert(s);
+    }
+    size_t n = 2000;
+    b.run("embedded_spheres_" + std::to_string(n_spheres), [&]() {
+      emitter em{n};
+      em.set_direction<isotropic>();
+      transporter::ordinary_mc omc{container};
+      omc.set_seed(1);
+      omc.transport_radiation(em,"container");
+      return omc.outward_receiver("container").radiant_flux();
+    }, n, "packages");
+  }
+  std::cout << b << std::endl;
+  return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef flick_checkpoint
+#define flick_checkpoint
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+
+namespace flick {
+namespace transporter {
+  class checkpoint
+  // File that the state of a long run is written to, at the first
+  // opportunity after a number of packages and a wall time have
+  // passed since the last write. A file is replaced only when the
+  // new one is complete, so that a run stopped while writing leaves
+  // the previous checkpoint intact.
+  {
+    using clock = std::chrono::steady_clock;
+    std::string file_name_;
+    size_t packages_{0};
+    double seconds_{0};
+    size_t packages_since_{0};
+    clock::time_point last_{clock::now()};
+  public:
+    static constexpr char magic[8] = {'f','l','i','c','k','c','p','2'};
+    checkpoint() = default;
+    checkpoint(const std::string& file_name, size_t packages,
+	       double seconds = 0)
+      : file_name_{file_name}, packages_{packages}, seconds_{seconds} {
+      if (file_name.empty() || packages < 1 || seconds < 0)
+	throw std::runtime_error("checkpoint");
+    }
+    bool is_enabled() const {
+      return !file_name_.empty();
+    }
+    const std::string& file_name() const {
+      return file_name_;
+    }
+    size_t packages() const {
+      return packages_;
+    }
+    void count(size_t n_packages) {
+      packages_since_ += n_packages;
+    }
+    bool is_due() const {
+      std::chrono::duration<double> t = clock::now() - last_;
+      return packages_since_ >= packages_ && t.count() >= seconds_;
+    }
+    static uint64_t fingerprint(const std::string& configuration)
+    // FNV-1a hash of a description of what results depend on, to
+    // tell checkpoints of other configurations apart
+    {
+      uint64_t h = 0xcbf29ce484222325;
+      for (unsigned char c : configuration) {
+	h ^= c;
+	h *= 0x100000001b3;
+      }
+      return h;
+    }
+    template<size_t N>
+    static bool is_continued(const std::array<uint64_t,N>& found,
+			     const std::array<uint64_t,N>& expected,
+			     size_t n_progress)
+    // Headers start with a run number and then progress in the first
+    // n_progress elements after it. A checkpoint of another run is
+    // not continued, while one of the same run must agree on the
+    // rest of the header.
+    {
+      if (found[0] != expected[0])
+	return false;
+      for (size_t i=1+n_progress; i<N; ++i)
+	if (found[i] != expected[i])
+	  throw std::runtime_error("checkpoint mismatch");
+      return true;
+    }
+    template<class Write>
+    void write(Write w)
+    // Calls w with the stream of a new file
+    {
+      std::string tmp = file_name_ + ".tmp";
+      {
+	std::ofstream ofs(tmp, std::ios::binary);
+	ofs.write(magic, sizeof(magic));
+	w(ofs);
+	if (!ofs)
+	  throw std::runtime_error("checkpoint write");
+      }
+      std::filesystem::rename(tmp, file_name_);
+      packages_since_ = 0;
+      last_ = clock::now();
+    }
+    template<class Read>
+    bool read(Read r) const
+    // Calls r with the stream of the file if there is one
+    {
+      std::ifstream ifs(file_name_, std::ios::binary);
+      if (!ifs)
+	return false;
+      char m[sizeof(magic)];
+      ifs.read(m, sizeof(m));
+      if (!ifs || std::memcmp(m, magic, sizeof(magic)) != 0)
+	throw std::runtime_error("checkpoint format");
+      r(ifs);
+      return true;
+    }
+  };
+}
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef flick_diffusion_step
+#define flick_diffusion_step
+
+#include "../numeric/tabulated_distribution.hpp"
+#include "../numeric/direction_generator.hpp"
+#include "../component/radiation_package.hpp"
+
+namespace flick {
+namespace transporter {
+  class diffusion_step
+  // Jump of a package in a homogeneous medium across a sphere, in
+  // place of the scattering events inside it. Packages scatter with
+  // coefficient b and asymmetry factor g and are absorbed through
+  // their weights, so that their positions diffuse with coefficient
+  // D = 1/(3b(1-g)). Diffusion starts at the center of the sphere and
+  // ends at a uniformly distributed point on it, after a path length
+  // s where sD/R^2 has the same distribution for any radius R.
+  // Weights are scaled by exp(-as) for absorption coefficient a, and
+  // polarization is lost.
+  //
+  // Free paths have mean 1/b and successive directions mean cosine
+  // g, so the k-th path from now moves a package on average g^k/b
+  // along its current direction. Before turning, a scattering
+  // package thus ends on average sum_{k>=1} g^k/b = g/(b(1-g)) ahead,
+  // where the sphere is centered. A package about to fly in a new
+  // direction u ends on average sum_{k>=0} g^k/b = 1/(b(1-g)) along
+  // u, so it leaves in an isotropic u from that distance behind the
+  // exit point.
+  {
+    double absorption_coefficient_;
+    double transport_coefficient_;
+    double g_;
+  public:
+    diffusion_step(double absorption_coefficient,
+		   double scattering_coefficient, double asymmetry_factor)
+      : absorption_coefficient_{absorption_coefficient},
+	transport_coefficient_{scattering_coefficient*(1-asymmetry_factor)},
+	g_{asymmetry_factor} {}
+    double transport_coefficient() const {
+      return transport_coefficient_;
+    }
+    double center_distance() const
+    // From a scattered package to the center of the sphere
+    {
+      return g_/transport_coefficient_;
+    }
+    double exit_distance() const
+    // From the sphere into the package's new direction
+    {
+      return 1/transport_coefficient_;
+    }
+    double path_length(double radius, double p) const
+    // Path length at probability p of leaving the sphere
+    {
+      return first_passage().quantile(p)*3*radius*radius*transport_coefficient_;
+    }
+    void jump(radiation_package& rp, const uniform_random& rnd,
+	      double radius) const
+    // The sphere, and exit_distance around it, must be free of walls
+    {
+      direction_generator dg{rnd};
+      vector center = rp.pose().position()
+	+ rp.pose().z_direction()*center_distance();
+      unit_vector normal = dg.isotropic();
+      unit_vector direction = dg.isotropic();
+      double s = path_length(radius, rnd(0,1));
+      double l = rp.traveling_length();
+      rp.move_to(center + normal*radius - direction*exit_distance());
+      rp.traveling_length(l+s);
+      rp.rotate_to(rotation{direction});
+      mueller m;
+      m.add(0,0,exp(-absorption_coefficient_*s));
+      rp.interact_with_matter(m);
+    }
+    static const tabulated_distribution& first_passage()
+    // Distribution of sD/R^2, with density minus the derivative of
+    // the probability 2 sum_n (-1)^(n+1) exp(-n^2 pi^2 sD/R^2) of
+    // still being inside the sphere
+    {
+      static const tabulated_distribution d = tabulate_first_passage();
+      return d;
+    }
+  private:
+    static tabulated_distribution tabulate_first_passage() {
+      using constants::pi;
+      size_t n_points = 4000;
+      double x_max = 2;
+      std::vector<double> x(n_points), f(n_points);
+      for (size_t i=0; i<n_points; ++i) {
+	x[i] = x_max*i/(n_points-1);
+	if (i == 0)
+	  continue;
+	double sum = 0;
+	for (int n=1; n<=200; ++n)
+	  sum += (n % 2 ? 1 : -1)*n*n*exp(-n*n*pi*pi*x[i]);
+	f[i] = std::max(2*pi*pi*sum, 0.0);
+      }
+      return tabulated_distribution(x, f);
+    }
+  };
+}
+}
+
+#endif
@@ -1,43 +1,177 @@
 #ifndef flick_material_interactor
 #define flick_material_interactor
 
+#include "medium_snapshot.hpp"
+
 namespace flick {
 namespace transporter {  
+  enum class scattering_sampling
+  // Scattering angles drawn from Henyey-Greenstein with the sampling
+  // asymmetry factor, or from the tabulated material phase function
+  {henyey_greenstein, phase_function};
+
+  struct directional_bias
+  // Scattering directions are drawn with probability fraction from a
+  // Henyey-Greenstein lobe with asymmetry factor concentration
+  // around direction, and otherwise as usual. Weights are divided by
+  // the density of the mixture, so that expected weights are
+  // unchanged.
+  {
+    unit_vector direction{0,0,1};
+    double fraction{0};
+    double concentration{0.9};
+  };
+
+  enum class peak_truncation
+  // Forward peaks of phase functions kept, truncated by delta
+  // scaling, or truncated only after the first scattering of each
+  // package, so that local estimates of single scattering see the
+  // whole peak
+  {none, delta_scaled, after_first_scattering};
+
+  inline double truncated_asymmetry_factor(const material::base& m)
+  // Asymmetry factor of the tabulated phase function, or 0 when
+  // nothing is truncated. Delta-Henyey-Greenstein scaling puts the
+  // fraction g^2 of scattering in a forward delta peak, and leaves a
+  // Henyey-Greenstein phase function with asymmetry factor g/(1+g).
+  {
+    if (!(m.scattering_coefficient() > 0))
+      return 0;
+    return std::max(m.scattering_mu_distribution().mean(), 0.0);
+  }
+
   class material_interactor {
     radiation_package& rp_;
     material::base& m_;
     uniform_random& rnd_;
     double scattering_optical_depth_;
     double g_;
+    scattering_sampling sampling_;
+    double sampling_density_;
     unit_vector scattering_direction_;
     double scattering_angle_;
     double distance_to_scattering_;
     double scattering_polar_angle_;
     double scattering_azimuth_angle_;
+    const content* spectral_content_{nullptr};
+    const compiled_material* compiled_;
+    double start_z_{0};
+    double start_uz_{0};
+    const directional_bias* bias_{nullptr};
+    double bias_density_{0};
+    double truncated_fraction_{0};
   public:
     material_interactor(radiation_package& rp,
 			material::base& m,
 			uniform_random& rnd,
 			double scattering_optical_depth,
-			double sampling_asymmetry_factor)
-      : rp_{rp}, m_{m}, rnd_{rnd}, g_{sampling_asymmetry_factor},
-	scattering_optical_depth_{scattering_optical_depth} {
+			double sampling_asymmetry_factor,
+			scattering_sampling sampling =
+			scattering_sampling::henyey_greenstein,
+			const compiled_material* compiled = nullptr)
+    // With compiled, the optical properties of m are read from it
+    // instead of from m, from where rp is now
+      : rp_{rp}, m_{m}, rnd_{rnd},
+	scattering_optical_depth_{scattering_optical_depth},
+	g_{sampling_asymmetry_factor}, sampling_{sampling},
+	compiled_{compiled} {
+      if (compiled_) {
+	start_z_ = rp_.pose().position().z();
+	start_uz_ = rp_.pose().direction().z();
+	distance_to_scattering_ = compiled_->scattering_distance(start_z_, start_uz_,
+								 scattering_optical_depth_);
+	return;
+      }
       m_.set(rp_.pose());
       distance_to_scattering_ = m_.scattering_distance(scattering_optical_depth_);
     }
+    void bias_toward(const directional_bias& b)
+    // Directions are then drawn from the mixture of b
+    {
+      bias_ = &b;
+    }
+    void truncate_forward_peak()
+    // Delta-scaled transport, with the scattering coefficient scaled
+    // by 1-f and directions drawn from the truncated phase function.
+    // Polarization follows the material's Mueller matrix, scaled to
+    // the truncated phase function.
+    {
+      if (compiled_ && !compiled_->is_homogeneous())
+	m_.set(rp_.pose());
+      double g = truncated_asymmetry_factor(m_);
+      if (g == 0)
+	return;
+      truncated_fraction_ = g*g;
+      g_ = g/(1+g);
+      sampling_ = scattering_sampling::henyey_greenstein;
+      double tau = scattering_optical_depth_/(1-truncated_fraction_);
+      if (compiled_)
+	distance_to_scattering_ = compiled_->scattering_distance(start_z_, start_uz_, tau);
+      else
+	distance_to_scattering_ = m_.scattering_distance(tau);
+    }
+    void carry_spectrum(const content& c)
+    // Weights of the companion wavelengths of spectral packages
+    // follow from the material copies of c
+    {
+      spectral_content_ = &c;
+      for (size_t i=0; i<rp_.n_wavelengths(); ++i)
+	c.material(i).set(rp_.pose());
+    }
     void move_to_scattering_event() {
       rp_.move(distance_to_scattering_);
     }
-    void deposite_energy_to_heat(double distance) {
-      double tau = m_.absorption_optical_depth(distance);
+    void deposite_energy_to_heat(double distance)
+    // Absorption of spectral packages is kept in the weights of all
+    // wavelengths, including the hero
+    {
+      if (spectral_content_) {
+	for (size_t i=0; i<rp_.n_wavelengths(); ++i) {
+	  double tau = spectral_content_->material(i).absorption_optical_depth(distance);
+	  rp_.scale_spectrum(i, exp(-tau), 1);
+	}
+	return;
+      }
+      double tau = absorption_optical_depth(distance);
       rp_.scale_intensity(exp(-tau));
     }
+    void travel_without_scattering(double distance)
+    // Probability of no scattering relative to the hero
+    {
+      if (!spectral_content_)
+	return;
+      double tau_hero = scattering_optical_depth(distance);
+      for (size_t i=0; i<rp_.n_wavelengths(); ++i) {
+	double tau = spectral_content_->material(i).scattering_optical_depth(distance);
+	double f = exp(tau_hero-tau);
+	rp_.scale_spectrum(i, f, f);
+      }
+    }
     double distance_to_scattering() {
       return distance_to_scattering_;
     }
+    double scattering_optical_depth(double distance) const {
+      double tau;
+      if (compiled_)
+	tau = compiled_->scattering_optical_depth(start_z_, start_uz_, distance);
+      else
+	tau = m_.scattering_optical_depth(distance);
+      return tau*(1-truncated_fraction_);
+    }
     void find_scattering_direction() {
-      scattering_polar_angle_ =
-	henyey_greenstein{g_}.inverted_accumulated_angle(rnd_(0,1));
+      if (bias_) {
+	find_biased_scattering_direction();
+	return;
+      }
+      if (sampling_ == scattering_sampling::phase_function) {
+	point s = scattering_mu_distribution().quantile_and_pdf(rnd_(0,1));
+	scattering_polar_angle_ = acos(std::clamp<double>(s.x(),-1,1));
+	sampling_density_ = s.y()/(2*constants::pi);
+      } else {
+	henyey_greenstein hg{g_};
+	scattering_polar_angle_ = hg.inverted_accumulated_angle(rnd_(0,1));
+	sampling_density_ = hg.phase_function(scattering_polar_angle_);
+      }
       scattering_azimuth_angle_ = rnd_(0,2*constants::pi);
       pose p = rp_.pose();
       p.rotate_about_local_z(scattering_azimuth_angle_);
@@ -48,21 +182,142 @@ namespace transporter {
       rp_.rotate_about_local_y(scattering_polar_angle_);
     }
     void reshape_polarization() {
-      rp_.interact_with_matter(m_.mueller_matrix(scattering_direction_));
+      mueller m = m_.mueller_matrix(scattering_direction_);
+      rp_.interact_with_matter(m);
+      rp_.scale_intensity(truncation_factor(m, scattering_polar_angle_));
     }
     void likelihood_scale_intensity() {
-      double hg = henyey_greenstein{g_}.phase_function(scattering_polar_angle_);
-      rp_.scale_intensity(1/hg);
+      rp_.scale_intensity(1/sampling_density_);
     }
-    void scatter() {
+    void arrive_at_scattering_event() {
+      travel_without_scattering(distance_to_scattering_);
       move_to_scattering_event();
+    }
+    void change_direction() {
+      if (compiled_)
+	m_.set(rp_.pose());
       find_scattering_direction();
+      weight_spectrum_at_scattering();
       likelihood_scale_intensity();
       make_x_axis_parallel_with_scattering_plane();
       reshape_polarization();    
       reorient_traveling_direction();
     }
+    void scatter() {
+      arrive_at_scattering_event();
+      change_direction();
+    }
+    double scattered_intensity(const unit_vector& direction) {
+      return scattered_package(direction).stokes().I();
+    }
+    radiation_package scattered_package(const unit_vector& direction)
+    // Package traveling in direction from the current position, with
+    // the Stokes vector scattered into it per unit solid angle
+    {
+      m_.set(rp_.pose());
+      pose p = rp_.pose();
+      double azimuth = atan2(dot(direction,p.y_direction()),
+			     dot(direction,p.x_direction()));
+      radiation_package rp = rp_;
+      rp.rotate_about_local_z(azimuth);
+      mueller m = m_.mueller_matrix(direction);
+      rp.interact_with_matter(m);
+      double mu = dot(direction,p.z_direction());
+      double theta = acos(std::clamp<double>(mu,-1,1));
+      rp.scale_intensity(truncation_factor(m, theta));
+      rp.rotate_about_local_y(theta);
+      return rp;
+    }
   private:
+    double truncation_factor(const mueller& m, double scattering_angle) const
+    // Truncated phase function relative to the material's
+    {
+      if (truncated_fraction_ == 0)
+	return 1;
+      double p = m.value(0,0);
+      double p_truncated = henyey_greenstein{g_}.phase_function(scattering_angle);
+      return p > 0 ? p_truncated/p : 0;
+    }
+    void find_biased_scattering_direction() {
+      henyey_greenstein lobe{bias_->concentration};
+      pose p = rp_.pose();
+      if (rnd_(0,1) < bias_->fraction) {
+	rotation r{bias_->direction};
+	r.rotate_about_local_z(rnd_(0,2*constants::pi));
+	r.rotate_about_local_y(lobe.inverted_accumulated_angle(rnd_(0,1)));
+	scattering_direction_ = r.z_direction();
+	double mu = dot(scattering_direction_, p.z_direction());
+	scattering_polar_angle_ = acos(std::clamp<double>(mu,-1,1));
+	scattering_azimuth_angle_ = atan2(dot(scattering_direction_,p.y_direction()),
+					  dot(scattering_direction_,p.x_direction()));
+      } else {
+	if (sampling_ == scattering_sampling::phase_function) {
+	  double mu = scattering_mu_distribution().quantile_and_pdf(rnd_(0,1)).x();
+	  scattering_polar_angle_ = acos(std::clamp<double>(mu,-1,1));
+	} else {
+	  henyey_greenstein hg{g_};
+	  scattering_polar_angle_ = hg.inverted_accumulated_angle(rnd_(0,1));
+	}
+	scattering_azimuth_angle_ = rnd_(0,2*constants::pi);
+	p.rotate_about_local_z(scattering_azimuth_angle_);
+	p.rotate_about_local_y(scattering_polar_angle_);
+	scattering_direction_ = p.z_direction();
+      }
+      double mu_b = dot(scattering_direction_, bias_->direction);
+      bias_density_ = bias_->fraction*lobe.phase_function(acos(std::clamp<double>(mu_b,-1,1)));
+      sampling_density_ = (1-bias_->fraction)*usual_density(scattering_polar_angle_)
+	+ bias_density_;
+    }
+    double mixed_density(double mu_density) const
+    // Density of the drawn direction when the usual part is drawn
+    // with mu_density, which is returned as is without bias
+    {
+      if (!bias_)
+	return mu_density;
+      return (1-bias_->fraction)*mu_density/(2*constants::pi) + bias_density_;
+    }
+    double usual_density(double polar_angle) const
+    // Density per solid angle of directions drawn without bias
+    {
+      if (sampling_ == scattering_sampling::phase_function)
+	return scattering_mu_distribution().pdf(cos(polar_angle))/(2*constants::pi);
+      return henyey_greenstein{g_}.phase_function(polar_angle);
+    }
+    double absorption_optical_depth(double distance) const {
+      if (compiled_)
+	return compiled_->absorption_optical_depth(start_z_, start_uz_, distance);
+      return m_.absorption_optical_depth(distance);
+    }
+    const tabulated_distribution& scattering_mu_distribution() const {
+      if (compiled_ && compiled_->scattering_mu)
+	return *compiled_->scattering_mu;
+      return m_.scattering_mu_distribution();
+    }
+    void weight_spectrum_at_scattering()
+    // Scattering coefficient and phase function relative to the hero,
+    // and the density of the scattering angle if it was drawn from the
+    // hero's phase function
+    {
+      if (!spectral_content_)
+	return;
+      double mu = cos(scattering_polar_angle_);
+      for (size_t i=0; i<rp_.n_wavelengths(); ++i)
+	spectral_content_->material(i).set(rp_.pose());
+      double b_hero = m_.scattering_coefficient();
+      double p_hero = m_.mueller_matrix(scattering_direction_).value(0,0);
+      double q_hero = 1;
+      if (sampling_ == scattering_sampling::phase_function)
+	q_hero = mixed_density(scattering_mu_distribution().pdf(mu));
+      for (size_t i=0; i<rp_.n_wavelengths(); ++i) {
+	material::base& m = spectral_content_->material(i);
+	double b = m.scattering_coefficient()/b_hero;
+	double p = m.mueller_matrix(scattering_direction_).value(0,0)/p_hero;
+	double q = 1;
+	if (sampling_ == scattering_sampling::phase_function)
+	  q = mixed_density(m.scattering_mu_distribution().pdf(mu))/q_hero;
+	rp_.scale_spectrum(i, b*p, b*q);
+      }
+    }
     void make_x_axis_parallel_with_scattering_plane() {
       rp_.rotate_about_local_z(scattering_azimuth_angle_);
     }
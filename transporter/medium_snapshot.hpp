@@ -0,0 +1,200 @@
+#ifndef flick_medium_snapshot
+#define flick_medium_snapshot
+
+#include <algorithm>
+#include <unordered_map>
+#include "../geometry/volume.hpp"
+#include "../component/content.hpp"
+
+namespace flick {
+namespace transporter {
+  class height_profile
+  // Optical depths from the lowest height of a material that changes
+  // with height only, at its grid heights with each interval divided
+  // into equal parts. The coefficient is constant within a part, so
+  // that optical depths are those of the material at every tabulated
+  // height. Outside the grid the end coefficients continue, while
+  // the material extrapolates its profile, so the grid should cover
+  // the volume.
+  {
+    std::vector<double> heights_;
+    std::vector<double> absorption_;
+    std::vector<double> scattering_;
+    static constexpr double epsilon_ = std::numeric_limits<double>::epsilon()*10;
+  public:
+    static constexpr size_t n_parts = 32;
+    height_profile() = default;
+    height_profile(material::base& m) {
+      stdvector h = m.profile_heights();
+      for (size_t i=0; i+1<h.size(); ++i)
+	for (size_t j=0; j<n_parts; ++j)
+	  heights_.push_back(h[i] + (h[i+1]-h[i])*j/n_parts);
+      heights_.push_back(h.back());
+      pose p0 = m.pose();
+      vector r = p0.position();
+      m.set(pose{vector{r.x(),r.y(),heights_.front()},unit_vector{0,0,1}});
+      for (double z : heights_) {
+	absorption_.push_back(m.absorption_optical_depth(z-heights_.front()));
+	scattering_.push_back(m.scattering_optical_depth(z-heights_.front()));
+      }
+      m.set(p0);
+    }
+    bool empty() const {
+      return heights_.empty();
+    }
+    double absorption_optical_depth(double z, double uz, double distance) const {
+      return optical_depth(absorption_, z, uz, distance);
+    }
+    double scattering_optical_depth(double z, double uz, double distance) const {
+      return optical_depth(scattering_, z, uz, distance);
+    }
+    double scattering_distance(double z, double uz,
+			       double scattering_optical_depth) const {
+      double l;
+      if (fabs(uz) < epsilon_)
+	l = scattering_optical_depth/coefficient(scattering_, part(z));
+      else {
+	double t = cumulative(scattering_, z) + scattering_optical_depth*uz;
+	l = (height_at(scattering_, t, uz > 0) - z)/uz;
+      }
+      if (std::isfinite(l))
+	return l;
+      return std::numeric_limits<double>::max();
+    }
+  private:
+    size_t part(double z) const
+    // Index of the part containing z, or of the end part nearest to it
+    {
+      size_t i = std::upper_bound(heights_.begin(), heights_.end(), z)
+	- heights_.begin();
+      return std::clamp<size_t>(i, 1, heights_.size()-1) - 1;
+    }
+    double coefficient(const std::vector<double>& tau, size_t i) const {
+      return (tau[i+1]-tau[i])/(heights_[i+1]-heights_[i]);
+    }
+    double cumulative(const std::vector<double>& tau, double z) const {
+      size_t i = part(z);
+      return tau[i] + coefficient(tau, i)*(z-heights_[i]);
+    }
+    double optical_depth(const std::vector<double>& tau, double z, double uz,
+			 double distance) const {
+      if (fabs(uz) < epsilon_)
+	return coefficient(tau, part(z))*distance;
+      return (cumulative(tau, z+uz*distance) - cumulative(tau, z))/uz;
+    }
+    double height_at(const std::vector<double>& tau, double t, bool upward) const
+    // Lowest height with optical depth t going upward, and highest
+    // going downward
+    {
+      auto k = upward ? std::lower_bound(tau.begin(), tau.end(), t)
+	: std::upper_bound(tau.begin(), tau.end(), t);
+      size_t i = std::clamp<size_t>(k - tau.begin(), 1, tau.size()-1) - 1;
+      if (t == tau[i])
+	return heights_[i];
+      return heights_[i] + (t-tau[i])/coefficient(tau, i);
+    }
+  };
+
+  struct compiled_material
+  // Optical properties of a material at one wavelength, as
+  // coefficients of a homogeneous material or as the profile of one
+  // that changes with height only. Optical depths and distances start
+  // at height z with vertical direction cosine uz.
+  {
+    double absorption_coefficient{0};
+    double scattering_coefficient{0};
+    const tabulated_distribution* scattering_mu{nullptr};
+    height_profile profile{};
+    bool is_homogeneous() const {
+      return profile.empty();
+    }
+    double absorption_optical_depth(double z, double uz, double distance) const {
+      if (!is_homogeneous())
+	return profile.absorption_optical_depth(z, uz, distance);
+      return absorption_coefficient*distance;
+    }
+    double scattering_optical_depth(double z, double uz, double distance) const {
+      if (!is_homogeneous())
+	return profile.scattering_optical_depth(z, uz, distance);
+      return scattering_coefficient*distance;
+    }
+    double scattering_distance(double z, double uz,
+			       double scattering_optical_depth) const {
+      if (!is_homogeneous())
+	return profile.scattering_distance(z, uz, scattering_optical_depth);
+      double l = scattering_optical_depth/scattering_coefficient;
+      if (std::isfinite(l))
+	return l;
+      return std::numeric_limits<double>::max();
+    }
+  };
+
+  class medium_snapshot
+  // Optical properties of the materials in a volume tree, read once at
+  // the current wavelength so that the transport loop uses plain data
+  // instead of calling the materials. Volumes without material count
+  // as vacuum. Materials that change with height only are tabulated
+  // without phase tables, since their phase function may change with
+  // height too. Volumes with other materials that change with
+  // position are left out.
+  {
+    std::vector<compiled_material> materials_;
+    std::unordered_map<const geometry::volume<content>*, size_t> index_;
+    mutable const geometry::volume<content>* last_volume_{nullptr};
+    mutable const compiled_material* last_material_{nullptr};
+  public:
+    medium_snapshot() = default;
+    medium_snapshot(geometry::volume<content>& v, bool with_phase_tables)
+    // Phase tables are needed for sampling from the phase function only
+    {
+      compile(v, with_phase_tables);
+    }
+    medium_snapshot(const medium_snapshot& s)
+      : materials_{s.materials_}, index_{s.index_} {}
+    medium_snapshot& operator=(const medium_snapshot& s) {
+      materials_ = s.materials_;
+      index_ = s.index_;
+      last_volume_ = nullptr;
+      last_material_ = nullptr;
+      return *this;
+    }
+    size_t size() const {
+      return materials_.size();
+    }
+    const compiled_material* find(const geometry::volume<content>& v) const
+    // Null if the material of v is not compiled
+    {
+      if (&v == last_volume_)
+	return last_material_;
+      auto i = index_.find(&v);
+      last_volume_ = &v;
+      last_material_ = (i == index_.end()) ? nullptr : &materials_[i->second];
+      return last_material_;
+    }
+  private:
+    void compile(geometry::volume<content>& v, bool with_phase_tables) {
+      const content& c = v.content();
+      if (!c.has_material()) {
+	index_[&v] = materials_.size();
+	materials_.push_back({});
+      } else if (c.material().is_homogeneous()) {
+	const material::base& m = c.material();
+	compiled_material cm{m.absorption_coefficient(), m.scattering_coefficient()};
+	if (with_phase_tables && cm.scattering_coefficient > 0)
+	  cm.scattering_mu = &m.scattering_mu_distribution();
+	index_[&v] = materials_.size();
+	materials_.push_back(cm);
+      } else if (c.material().profile_heights().size() > 1) {
+	compiled_material cm;
+	cm.profile = height_profile(c.material());
+	index_[&v] = materials_.size();
+	materials_.push_back(cm);
+      }
+      for (size_t i=0; i<v.n_inner_volumes(); ++i)
+	compile(v.inner_volume(i), with_phase_tables);
+    }
+  };
+}
+}
+
+#endif
@@ -1,8 +1,19 @@
 #ifndef flick_ordinary_mc
 #define flick_ordinary_mc
 
+#include <thread>
+#include <exception>
+#include <sstream>
+#include <typeinfo>
 #include "wall_interactor.hpp"
 #include "material_interactor.hpp"
+#include "diffusion_step.hpp"
+#include "weight_window.hpp"
+#include "workers.hpp"
+#include "transport_statistics.hpp"
+#include "checkpoint.hpp"
+#include "../numeric/sobol_sequence.hpp"
+#include "../component/detector.hpp"
 #include "../material/material.hpp"
 
 namespace flick {
@@ -13,11 +24,239 @@ namespace transporter {
     geometry::navigator<flick::content> nav_;
     radiation_package rp_;
     std::optional<pose> intersection_;
+    size_t n_threads_{1};
+    uint64_t n_worker_streams_{0};
+    scattering_sampling scattering_sampling_{scattering_sampling::henyey_greenstein};
+    std::vector<flick::content*> spectral_contents_;
+    struct banked_package {
+      radiation_package rp;
+      geometry::volume<flick::content>* volume;
+      double scattering_optical_depth;
+      bool forces_collision{false};
+      bool truncates{false};
+    };
+    std::vector<banked_package> bank_;
+    transporter::weight_window weight_window_;
+    std::vector<std::shared_ptr<flick::detector>> detectors_;
+    bool uses_compiled_medium_{true};
+    std::vector<medium_snapshot> snapshots_;
+    const medium_snapshot* snapshot_{nullptr};
+    transport_statistics statistics_;
+    bool collects_statistics_{false};
+    bool is_adjoint_{false};
+    transporter::checkpoint checkpoint_;
+    uint64_t n_checkpointed_runs_{0};
+    bool is_seeded_{false};
+    bool forces_first_collision_{false};
+    bool forces_collision_{false};
+    std::optional<directional_bias> directional_bias_;
+    peak_truncation peak_truncation_{peak_truncation::none};
+    bool truncates_{false};
+    double diffusion_radius_{0};
+    std::optional<sobol_sequence> quasi_random_;
+    uint64_t quasi_random_seed_{0};
+    uint64_t n_quasi_random_points_{0};
   public:
     ordinary_mc(const geometry::volume<flick::content>& outer_volume)
       : outer_volume_{outer_volume} {
       nav_ = geometry::navigator<flick::content>(outer_volume_);
     }
+    void set_seed(uint64_t seed, uint64_t stream = 0)
+    // Makes runs reproducible for a given seed and number of
+    // threads. Threads use the streams following the given one, so
+    // independent processes with the same seed should start at
+    // streams far apart.
+    {
+      rnd_ = uniform_random(seed, stream);
+      n_worker_streams_ = 0;
+      is_seeded_ = true;
+    }
+    void set_checkpoint(const transporter::checkpoint& c)
+    // Runs are then done in parts of c.packages() packages, after
+    // which the state is written to the checkpoint file when due, and
+    // at the end of the run. A run finding a checkpoint of itself,
+    // the same run counted from this call, continues from it, and
+    // throws if the checkpoint was written with another seed, stream,
+    // number of threads, checkpoint packages, emitter or
+    // configuration of volumes and transport. Results
+    // are then those of an uninterrupted run with the same seed,
+    // threads and checkpoint packages. With one thread, they are also
+    // those of a run without checkpoints. Active receivers must use
+    // tallies.
+    {
+      checkpoint_ = c;
+      n_checkpointed_runs_ = 0;
+    }
+    void write_state(std::ostream& os)
+    // Random numbers drawn, receiver tallies, detector sums and
+    // statistics, enough for an equal transporter to continue
+    {
+      rnd_.write_state(os);
+      write_binary(os, n_worker_streams_);
+      write_binary(os, quasi_random_seed_);
+      write_binary(os, n_quasi_random_points_);
+      write_receivers(os, outer_volume_);
+      write_binary(os, uint64_t{detectors_.size()});
+      for (auto& d : detectors_)
+	d->write_state(os);
+      write_binary(os, weight_window_.statistics());
+      statistics_.write_state(os);
+    }
+    void read_state(std::istream& is) {
+      rnd_.read_state(is);
+      read_binary(is, n_worker_streams_);
+      read_binary(is, quasi_random_seed_);
+      read_binary(is, n_quasi_random_points_);
+      if (quasi_random_)
+	quasi_random_->randomize(quasi_random_seed_);
+      read_receivers(is, outer_volume_);
+      uint64_t n_detectors;
+      read_binary(is, n_detectors);
+      if (n_detectors != detectors_.size())
+	throw std::runtime_error("ordinary_mc state");
+      for (auto& d : detectors_)
+	d->read_state(is);
+      weight_window_statistics w;
+      read_binary(is, w);
+      weight_window_.clear_statistics();
+      weight_window_.add_statistics(w);
+      statistics_.read_state(is);
+    }
+    void set_threads(size_t n_threads)
+    // Packages are divided between threads, each with its own random
+    // number stream and receivers. Receivers are merged in thread
+    // order after transport.
+    {
+      if (n_threads < 1)
+	throw std::runtime_error("ordinary_mc threads");
+      n_threads_ = n_threads;
+    }
+    void set_scattering_sampling(scattering_sampling s)
+    // The sampling asymmetry factor is used with Henyey-Greenstein
+    // sampling only
+    {
+      scattering_sampling_ = s;
+    }
+    void set_compiled_medium(bool on)
+    // Homogeneous materials are read at the start of each run into
+    // a snapshot for each emitted wavelength. Without it, materials
+    // are called at every step, giving the same results more slowly.
+    {
+      uses_compiled_medium_ = on;
+    }
+    void set_russian_roulette(double threshold, double survival_weight)
+    // Packages with weight below threshold survive with probability
+    // weight/survival_weight, carrying the survival weight
+    {
+      weight_window_.set_russian_roulette(threshold, survival_weight);
+    }
+    void set_splitting(double threshold, size_t max_copies)
+    // Packages with weight above threshold are split into copies of
+    // equal weight, followed one after another
+    {
+      weight_window_.set_splitting(threshold, max_copies);
+    }
+    void set_interface_splitting(bool on)
+    // Both the reflected and the transmitted package are followed at
+    // interfaces where both are possible
+    {
+      weight_window_.set_interface_splitting(on);
+    }
+    void force_first_collision(bool on)
+    // Emitted packages are split at their first step through a
+    // scattering medium toward a wall. The part scattering before the
+    // wall is made to scatter, at a distance drawn from the truncated
+    // free path distribution, and the rest is carried to the wall.
+    // Thin media then give every package a scattering event.
+    {
+      forces_first_collision_ = on;
+    }
+    void set_directional_bias(const unit_vector& direction, double fraction,
+			      double concentration = 0.9)
+    // Scattering directions are drawn with probability fraction from
+    // a Henyey-Greenstein lobe with asymmetry factor concentration
+    // around direction, typically that of a receiver's acceptance
+    // cone, with weights corrected for the changed density. A
+    // fraction of 0 removes the bias.
+    {
+      if (fraction < 0 || fraction > 1 || !(fabs(concentration) < 1))
+	throw std::runtime_error("ordinary_mc directional bias");
+      if (fraction == 0)
+	directional_bias_.reset();
+      else
+	directional_bias_ = directional_bias{direction, fraction, concentration};
+    }
+    void truncate_forward_peaks(peak_truncation t)
+    // Delta-scaled transport for fluxes through media with strongly
+    // forward scattering, where packages then scatter far less
+    // often. With after_first_scattering, local estimates of single
+    // scattering use the whole phase function, which keeps radiance
+    // near the forward peak. Not for spectral packages.
+    {
+      peak_truncation_ = t;
+    }
+    void set_diffusion_steps(double minimum_radius)
+    // Packages scattering in homogeneous media at least
+    // minimum_radius transport mean free paths from any wall jump to
+    // the surface of the largest sphere free of walls in one
+    // diffusion step. Ordinary transport takes over near walls. A
+    // radius of 0 turns diffusion steps off. Not for spectral
+    // packages or detectors, which are not scored inside the sphere.
+    {
+      if (minimum_radius < 0)
+	throw std::runtime_error("ordinary_mc diffusion steps");
+      diffusion_radius_ = minimum_radius;
+    }
+    void set_quasi_random(size_t n_dimensions)
+    // The first n_dimensions numbers drawn for each emitted package,
+    // for its direction, wavelength, first free path and first
+    // scatterings, are coordinates of an Owen-scrambled Sobol point,
+    // and later ones pseudo-random. Each run scrambles anew, so that
+    // runs are independent randomizations and the spread of their
+    // results estimates the error. A dimension of 0 turns it off.
+    {
+      if (n_dimensions == 0)
+	quasi_random_.reset();
+      else
+	quasi_random_ = sobol_sequence(n_dimensions);
+    }
+    void set_weight_window(const transporter::weight_window& ww) {
+      weight_window_ = ww;
+      weight_window_.clear_statistics();
+    }
+    const weight_window_statistics& variance_reduction_statistics() const
+    // Number of roulette games and splittings since construction
+    {
+      return weight_window_.statistics();
+    }
+    void collect_statistics(bool on)
+    // Count transport events and time the transport phases. Has no
+    // effect when compiled without transport statistics.
+    {
+      collects_statistics_ = on;
+    }
+    const transport_statistics& event_statistics() const
+    // Counts and times since construction
+    {
+      return statistics_;
+    }
+    template<class Detector, class... Args>
+    Detector& add_detector(Args... a)
+    // Local estimate detectors are scored at every scattering event
+    // and Lambert reflection of monochromatic packages. Point
+    // detectors must be reached without crossing interfaces between
+    // refractive indices.
+    {
+      auto d = std::make_shared<Detector>(a...);
+      detectors_.push_back(d);
+      return *d;
+    }
+    size_t n_detectors() const {
+      return detectors_.size();
+    }
+    flick::detector& detector(size_t i) {
+      return *detectors_.at(i);
+    }
     bool lost_in_space() {
       return (!nav_.current_volume().has_outer_volume()
 	      && !intersection_.has_value());
@@ -31,50 +270,654 @@ namespace transporter {
     receiver& outward_receiver(const std::string& volume_name) {
       return nav_.find(volume_name).content().outward_receiver();
     }
+    double transport_adjoint(emitter em,
+			     const std::string& emitter_volume_name,
+			     const unit_vector& source_direction,
+			     double sampling_asymmetry_factor = 0.8)
+    // Backward transport for radiance in plane-parallel geometry. The
+    // emitter is placed at the detector and emits importance packages
+    // against the propagation direction of the detected radiance,
+    // with the Stokes vector of the detector's analyzer, {1,0,0,0}
+    // for radiance. At each scattering event, packages are scored
+    // toward a collimated unpolarized source traveling in
+    // source_direction. Mueller matrices then act in reversed order
+    // and transposed, since M^T = QMQ with Q = diag(1,1,-1,1) for
+    // scattering and rotation matrices, so the sign of U is flipped
+    // at emission. Returns the radiance from light scattered at least
+    // once, per unit source irradiance on horizontal planes, as
+    // forward runs give per emitted package with a
+    // direction_detector. Detectors added for forward runs are not
+    // scored, while receivers also receive importance packages.
+    {
+      if (em.is_spectral())
+	throw std::runtime_error("ordinary_mc adjoint spectral");
+      size_t n = em.packages_left();
+      if (n == 0)
+	return 0;
+      auto source = std::make_shared<direction_detector>(-source_direction);
+      std::vector<std::shared_ptr<flick::detector>> forward_detectors;
+      std::swap(detectors_, forward_detectors);
+      detectors_.push_back(source);
+      is_adjoint_ = true;
+      try {
+	transport_radiation(em, emitter_volume_name, sampling_asymmetry_factor);
+      } catch (...) {
+	is_adjoint_ = false;
+	detectors_ = forward_detectors;
+	throw;
+      }
+      is_adjoint_ = false;
+      detectors_ = forward_detectors;
+      return source->radiance()/n;
+    }
     void transport_radiation(emitter em,
 			     const std::string& emitter_volume_name,
 			     double sampling_asymmetry_factor = 0.8) {
+      if (checkpoint_.is_enabled()) {
+	transport_with_checkpoints(em, emitter_volume_name,
+				   sampling_asymmetry_factor);
+	return;
+      }
+      start_quasi_random_run();
+      transport_run(em, emitter_volume_name, sampling_asymmetry_factor);
+    }
+  private:
+    void transport_run(emitter& em, const std::string& emitter_volume_name,
+		       double sampling_asymmetry_factor) {
+      if (n_threads_ > 1) {
+	prepare_spectrum(em);
+	transport_in_parallel(em, emitter_volume_name, sampling_asymmetry_factor);
+	return;
+      }
+      prepare_spectrum(em);
+      if (em.is_spectral() && !detectors_.empty())
+	throw std::runtime_error("ordinary_mc spectral detectors");
+      if (em.is_spectral() && peak_truncation_ != peak_truncation::none)
+	throw std::runtime_error("ordinary_mc spectral truncation");
+      if (diffusion_radius_ > 0 && !detectors_.empty())
+	throw std::runtime_error("ordinary_mc diffusion detectors");
+      compile_medium(em);
       geometry::volume<flick::content>* ev = &nav_.find(emitter_volume_name);
+      if (statistics())
+	statistics()->start(transport_phase::sampling);
       while (!em.is_empty()) {
-	nav_.go_to(*ev);
-	rp_ = em.emit();
-	double scattering_optical_depth = -log(rnd_(0,1));
-	intersection_ = nav_.next_intersection(rp_.pose());
-	while (!rp_.is_empty() && !lost_in_space()) {
-	  if (!nav_.current_volume().content().has_material()) {
-	    nav_.current_volume().content().fill<material::vacuum>();
-	  }
-	  material::base& material = nav_.current_volume().content().material();
-	  material_interactor mi(rp_,material,rnd_,scattering_optical_depth,
-				 sampling_asymmetry_factor);
-	  double dw = distance_to_wall(intersection_);
-	  double ds = mi.distance_to_scattering();
-	  if (intersection_.has_value() && ds < dw) {
-	    mi.deposite_energy_to_heat(ds);
-	    mi.scatter();
-	    scattering_optical_depth = -log(rnd_(0,1));
-	  } 
-	  else if (intersection_.has_value()) {
-	    wall_interactor wi(nav_,rp_,rnd_);
-	    mi.deposite_energy_to_heat(dw);
-	    wi.interact_with_wall();
-	    scattering_optical_depth -= material.scattering_optical_depth(dw);
-	    if(scattering_optical_depth <= 0)
-	      throw std::runtime_error("ordinary_mc");
+	if (quasi_random_)
+	  rnd_.lead_with(quasi_random_->point(n_quasi_random_points_++));
+	rp_ = em.emit(rnd_);
+	if (is_adjoint_)
+	  rp_.interact_with_matter(transposing_matrix());
+	for (auto c : spectral_contents_)
+	  c->select_wavelength(rp_.hero());
+	if (!snapshots_.empty())
+	  snapshot_ = &snapshots_.at(rp_.is_spectral() ? rp_.hero() : 0);
+	bank_.push_back({rp_, ev, -log(rnd_(0,1)), forces_first_collision_,
+	    peak_truncation_ == peak_truncation::delta_scaled});
+	while (!bank_.empty()) {
+	  banked_package b = std::move(bank_.back());
+	  bank_.pop_back();
+	  rp_ = std::move(b.rp);
+	  nav_.go_to(*b.volume);
+	  if (statistics())
+	    statistics()->packages++;
+	  forces_collision_ = b.forces_collision;
+	  truncates_ = b.truncates;
+	  transport_package(b.scattering_optical_depth, sampling_asymmetry_factor);
+	}
+      }
+      enter(transport_phase::receiver);
+      flush_receivers(outer_volume_);
+      if (statistics())
+	statistics()->stop();
+    }
+    void start_quasi_random_run() {
+      if (quasi_random_) {
+	quasi_random_seed_ = rnd_(0,1)*0x1.0p64;
+	quasi_random_->randomize(quasi_random_seed_);
+	n_quasi_random_points_ = 0;
+      }
+    }
+    void transport_with_checkpoints(emitter& em,
+				    const std::string& emitter_volume_name,
+				    double sampling_asymmetry_factor) {
+      transporter::checkpoint c = checkpoint_;
+      uint64_t run = n_checkpointed_runs_++;
+      uint64_t n_done = 0;
+      std::array<uint64_t,9> header{run, n_done, em.packages_left(), is_seeded_,
+	is_seeded_ ? rnd_.seed() : 0, rnd_.stream_number(), n_threads_,
+	c.packages(), configuration_fingerprint(em, emitter_volume_name,
+						sampling_asymmetry_factor)};
+      c.read([&](std::istream& is) {
+	std::array<uint64_t,9> found;
+	read_binary(is, found);
+	if (transporter::checkpoint::is_continued(found, header, 1)) {
+	  n_done = found[1];
+	  read_state(is);
+	}
+      });
+      if (n_done == 0)
+	start_quasi_random_run();
+      em.take(n_done);
+      checkpoint_ = {};
+      try {
+	while (!em.is_empty()) {
+	  emitter part = em.take(c.packages());
+	  size_t m = part.packages_left();
+	  transport_run(part, emitter_volume_name, sampling_asymmetry_factor);
+	  n_done += m;
+	  c.count(m);
+	  if (c.is_due() || em.is_empty())
+	    c.write([&](std::ostream& os) {
+	      header[1] = n_done;
+	      write_binary(os, header);
+	      write_state(os);
+	    });
+	}
+      } catch (...) {
+	checkpoint_ = c;
+	throw;
+      }
+      checkpoint_ = c;
+    }
+    uint64_t configuration_fingerprint(const emitter& em,
+				       const std::string& emitter_volume_name,
+				       double sampling_asymmetry_factor)
+    // Volumes, their contents and transport settings of a run
+    {
+      std::ostringstream os;
+      os.precision(17);
+      os << em << " " << emitter_volume_name << " " << sampling_asymmetry_factor
+	 << " " << int(scattering_sampling_) << " " << int(peak_truncation_)
+	 << " " << forces_first_collision_ << " " << diffusion_radius_
+	 << " " << uses_compiled_medium_ << " " << is_adjoint_
+	 << " " << detectors_.size() << " " << weight_window_
+	 << " " << (quasi_random_ ? quasi_random_->n_dimensions() : 0);
+      if (directional_bias_)
+	os << " " << directional_bias_->direction << " " << directional_bias_->fraction
+	   << " " << directional_bias_->concentration;
+      os << "\n";
+      os << outer_volume_;
+      describe_contents(os, outer_volume_);
+      return transporter::checkpoint::fingerprint(os.str());
+    }
+    static void describe_contents(std::ostream& os,
+				  geometry::volume<flick::content>& v) {
+      flick::content& c = v.content();
+      if (c.has_material()) {
+	material::base& m = c.material();
+	os << typeid(m).name();
+	if (!c.has_spectrum()) {
+	  m.set(pose{});
+	  os << m;
+	}
+      }
+      if (c.has_coating())
+	os << " " << typeid(c.coating()).name();
+      os << "\n";
+      for (size_t i=0; i<v.n_inner_volumes(); ++i)
+	describe_contents(os, v.inner_volume(i));
+    }
+    void transport_package(double scattering_optical_depth,
+			   double sampling_asymmetry_factor)
+    // Follows rp_ from the current volume until it is empty or lost.
+    // Packages split off on the way are put in the bank.
+    {
+      enter(transport_phase::geometry);
+      intersection_ = nav_.next_intersection(rp_.pose());
+      while (!rp_.is_empty() && !lost_in_space()) {
+	if (statistics())
+	  statistics()->steps++;
+	enter(transport_phase::material);
+	if (!nav_.current_volume().content().has_material()) {
+	  nav_.current_volume().content().fill<material::vacuum>();
+	}
+	material::base& material = nav_.current_volume().content().material();
+	const compiled_material* cm = nullptr;
+	if (snapshot_)
+	  cm = snapshot_->find(nav_.current_volume());
+	if (forces_collision_ && intersection_.has_value())
+	  scattering_optical_depth = force_collision(material, cm,
+						     scattering_optical_depth);
+	material_interactor mi(rp_,material,rnd_,scattering_optical_depth,
+			       sampling_asymmetry_factor,scattering_sampling_,cm);
+	if (truncates_)
+	  mi.truncate_forward_peak();
+	if (directional_bias_)
+	  mi.bias_toward(*directional_bias_);
+	if (rp_.is_spectral())
+	  mi.carry_spectrum(nav_.current_volume().content());
+	double dw = distance_to_wall(intersection_);
+	double ds = mi.distance_to_scattering();
+	if (intersection_.has_value() && ds < dw) {
+	  if (statistics())
+	    statistics()->scattering_events++;
+	  mi.deposite_energy_to_heat(ds);
+	  mi.arrive_at_scattering_event();
+	  enter(transport_phase::receiver);
+	  score_detectors(mi, material);
+	  enter(transport_phase::material);
+	  if (!take_diffusion_step(material, cm))
+	    mi.change_direction();
+	  truncates_ = (peak_truncation_ != peak_truncation::none);
+	  enter(transport_phase::sampling);
+	  scattering_optical_depth = -log(rnd_(0,1));
+	  apply_weight_window();
+	}
+	else if (intersection_.has_value()) {
+	  enter(transport_phase::geometry);
+	  wall_interactor wi(nav_,rp_,rnd_,statistics());
+	  mi.deposite_energy_to_heat(dw);
+	  mi.travel_without_scattering(dw);
+	  enter(transport_phase::receiver);
+	  score_detectors_at_wall(wi);
+	  enter(transport_phase::geometry);
+	  bool split = weight_window_.splits_at_interfaces() && wi.can_split();
+	  if (split) {
+	    wi.split();
+	    weight_window_.count_interface_splitting();
 	  }
-	  else {
-	    exit_semi_infinite_volume();
+	  wi.interact_with_wall();
+	  scattering_optical_depth -= mi.scattering_optical_depth(dw);
+	  if(scattering_optical_depth <= 0)
+	    throw std::runtime_error("ordinary_mc");
+	  if (split)
+	    bank_.push_back({*wi.reflected_package(), &wi.reflected_volume(),
+		scattering_optical_depth, false, truncates_});
+	  enter(transport_phase::sampling);
+	  apply_weight_window();
+	}
+	else {
+	  exit_semi_infinite_volume();
+	}
+	enter(transport_phase::geometry);
+	intersection_ = nav_.next_intersection(rp_.pose());
+      }
+      count_termination();
+      enter(transport_phase::sampling);
+    }
+    transport_statistics* statistics()
+    // Null when statistics are not collected, so that they are
+    // compiled away without transport statistics
+    {
+      if constexpr (has_transport_statistics)
+	return collects_statistics_ ? &statistics_ : nullptr;
+      return nullptr;
+    }
+    static mueller transposing_matrix()
+    // Q in M^T = QMQ
+    {
+      mueller q;
+      q.add(0,0,1);
+      q.add(1,1,1);
+      q.add(2,2,-1);
+      q.add(3,3,1);
+      return q;
+    }
+    void enter(transport_phase p) {
+      if (statistics())
+	statistics()->enter(p);
+    }
+    void count_termination()
+    // Roulette kills and absorption at walls are counted where they
+    // happen, leaving packages with zero weight
+    {
+      if (!statistics())
+	return;
+      if (!rp_.is_empty())
+	statistics()->escaped++;
+      else if (rp_.weight() > 0)
+	statistics()->absorbed_in_media++;
+    }
+    void score_detectors(material_interactor& mi, material::base& material) {
+      if (detectors_.empty())
+	return;
+      for (auto& d : detectors_)
+	score_detector(*d, nav_, rp_.pose().position(),
+		       [&](const unit_vector& u) { return mi.scattered_package(u); });
+      material.set(rp_.pose());
+    }
+    void score_detectors_at_wall(const wall_interactor& wi)
+    // Lambert coatings reflect R*cos(theta)/pi of the incident weight
+    // per unit solid angle, and transmit T*cos(theta)/pi to the other
+    // side. Light transmitted through them is not scored for
+    // detectors that stop at opaque surfaces.
+    {
+      if (detectors_.empty()
+	  || dynamic_cast<coating::grey_lambert*>(&wi.coating()) == nullptr)
+	return;
+      double w = rp_.stokes().I();
+      const unit_vector& n = wi.surface_normal();
+      for (auto& d : detectors_) {
+	for (bool is_reflected : {true, false}) {
+	  double f = is_reflected ? wi.coating().unpolarized_reflectance()
+	    : wi.coating().unpolarized_transmittance();
+	  if (!(f > 0) || (!is_reflected && d->is_reached_at_opaque_surfaces()))
+	    continue;
+	  geometry::navigator<flick::content> nav = nav_;
+	  geometry::volume<flick::content>& v = is_reflected ?
+	    wi.current_volume() : wi.next_volume();
+	  nav.go_to(v);
+	  double side = is_reflected ? 1 : -1;
+	  vector position = rp_.pose().position() + side*v.small_step()*n;
+	  score_detector(*d, nav, position, [&](const unit_vector& u) {
+	    double cos_theta = side*dot(u,n);
+	    radiation_package rp{pose{position,u},
+	      stokes{w*f*std::max(cos_theta,0.0)/constants::pi,0,0,0}};
+	    return rp;
+	  });
+	}
+      }
+    }
+    template<class Source>
+    void score_detector(flick::detector& d,
+			const geometry::navigator<flick::content>& nav,
+			const vector& position, Source package_toward)
+    // Adds light leaving position, given per unit solid angle by
+    // package_toward for each direction. Paths to direction
+    // detectors are refracted at interfaces between refractive
+    // indices, and start in the direction that ends up parallel to
+    // the detector's in plane-parallel geometry. Radiance is then
+    // scaled by the Fresnel transmittance and the squared ratio of
+    // refractive indices.
+    {
+      unit_vector direction = d.direction_from(position);
+      radiation_package rp = package_toward(direction);
+      std::optional<detector_path> path = follow_path(d, nav, rp, false);
+      if (path && path->is_refracted) {
+	double s = path->refractive_index_ratio;
+	double x = direction.x()*s;
+	double y = direction.y()*s;
+	if (!(x*x + y*y < 1))
+	  return;
+	direction = unit_vector{x, y, std::copysign(sqrt(1-x*x-y*y), direction.z())};
+	rp = package_toward(direction);
+	path = follow_path(d, nav, rp, true);
+	if (path && dot(rp.pose().z_direction(), d.direction_from(position)) < 1-1e-9)
+	  throw std::runtime_error("ordinary_mc detector path");
+      }
+      if (!path)
+	return;
+      double intensity = rp.stokes().I();
+      if (path->is_refracted)
+	intensity *= pow(path->refractive_index_ratio,2)
+	  *fabs(rp.pose().z_direction().z()/direction.z());
+      d.add(intensity, path->optical_depth, position);
+    }
+    struct detector_path {
+      double optical_depth;
+      double refractive_index_ratio;
+      bool is_refracted;
+    };
+    std::optional<detector_path> follow_path(const flick::detector& d,
+					     geometry::navigator<flick::content> nav,
+					     radiation_package& rp, bool refracts)
+    // Along the path of rp from its position to the detector. With
+    // refracts, the path is refracted and polarized by Fresnel
+    // transmission at interfaces between refractive indices, and
+    // otherwise only marked as refracted. Paths blocked by opaque
+    // surfaces to point detectors, and paths totally reflected,
+    // give no value. Point detectors behind such interfaces are not
+    // supported. The ratio is of the refractive index where the path
+    // ends to where it starts.
+    {
+      double n_start = refractive_index(nav.current_volume());
+      double distance_left = d.distance_from(rp.pose().position());
+      if (!(distance_left > 1e-12))
+	return std::nullopt;
+      double tau = 0;
+      bool is_refracted = false;
+      for (size_t n=0; n<1000; ++n) {
+	pose p = rp.pose();
+	geometry::volume<flick::content>& v = nav.current_volume();
+	material::base* m = nullptr;
+	if (v.content().has_material()) {
+	  m = &v.content().material();
+	  m->set(p);
+	}
+	std::optional<pose> wall = nav.next_intersection(p);
+	if (!wall.has_value()) {
+	  if (!v.has_outer_volume()) {
+	    if (m && std::isfinite(distance_left))
+	      tau += optical_depth(*m, distance_left);
+	    return detector_path{tau, refractive_index(v)/n_start, is_refracted};
 	  }
-	  intersection_ = nav_.next_intersection(rp_.pose());
+	  nav.go_outward();
+	  continue;
+	}
+	double dw = norm(wall->position()-p.position());
+	if (dw >= distance_left) {
+	  if (m)
+	    tau += optical_depth(*m, distance_left);
+	  return detector_path{tau, refractive_index(v)/n_start, is_refracted};
+	}
+	if (m)
+	  tau += optical_depth(*m, dw);
+	distance_left -= dw;
+	geometry::volume<flick::content>& next = nav.next_volume(p);
+	if (&next == &v)
+	  return detector_path{tau, refractive_index(v)/n_start, is_refracted};
+	bool is_moving_inward = nav.is_moving_inward(*wall, p);
+	flick::content& coated = is_moving_inward ? next.content() : v.content();
+	if (coated.has_coating()
+	    && dynamic_cast<coating::fresnel*>(&coated.coating()) == nullptr) {
+	  if (d.is_reached_at_opaque_surfaces())
+	    return detector_path{tau, refractive_index(v)/n_start, is_refracted};
+	  return std::nullopt;
 	}
+	rp.move_to(wall->position());
+	if (refractive_index(next) != refractive_index(v)) {
+	  if (std::isfinite(distance_left))
+	    throw std::runtime_error("ordinary_mc point detector refraction");
+	  if (refracts && !refract(rp, *wall, refractive_index(next)/refractive_index(v)))
+	    return std::nullopt;
+	  is_refracted = true;
+	}
+	rp.move_by(rp.pose().z_direction()*v.small_step());
+	distance_left -= v.small_step();
+	nav.go_to(next);
       }
+      throw std::runtime_error("ordinary_mc detector path");
+    }
+    static bool refract(radiation_package& rp, const pose& wall,
+			double relative_refractive_index)
+    // Fresnel transmission of rp at wall, false at total reflection
+    {
+      unit_vector normal = wall.z_direction();
+      if (dot(normal,rp.pose().z_direction()) > 0)
+	normal = -normal;
+      double cos_theta = -dot(normal,rp.pose().z_direction());
+      if (1-cos_theta*cos_theta >= pow(relative_refractive_index,2))
+	return false;
+      align_with_plane_of_incidence(rp, normal);
+      coating::fresnel f;
+      f.set_incidence(rotation{rp.pose().rotation()});
+      f.set(normal);
+      f.set(std::complex<double>{relative_refractive_index,0});
+      rp.interact_with_matter(f.transmission_mueller_matrix());
+      rp.rotate_to(f.transmission_rotation());
+      return true;
+    }
+    double optical_depth(const material::base& m, double distance) const
+    // With scattering scaled as in truncated transport
+    {
+      double tau = m.scattering_optical_depth(distance);
+      if (peak_truncation_ != peak_truncation::none) {
+	double g = truncated_asymmetry_factor(m);
+	tau *= 1-g*g;
+      }
+      return m.absorption_optical_depth(distance) + tau;
+    }
+    static double refractive_index(geometry::volume<flick::content>& v) {
+      if (!v.content().has_material())
+	return 1;
+      return v.content().material().real_refractive_index();
+    }
+    bool take_diffusion_step(material::base& material,
+			     const compiled_material* cm)
+    // Jumps rp_ to the surface of the largest sphere free of walls
+    // around it, if the sphere is large enough
+    {
+      if (diffusion_radius_ == 0 || rp_.is_spectral()
+	  || !material.is_homogeneous())
+	return false;
+      double a, b;
+      if (cm) {
+	a = cm->absorption_coefficient;
+	b = cm->scattering_coefficient;
+      } else {
+	a = material.absorption_coefficient();
+	b = material.scattering_coefficient();
+      }
+      if (!(b > 0))
+	return false;
+      diffusion_step step{a, b, material.scattering_mu_distribution().mean()};
+      geometry::volume<flick::content>& v = nav_.current_volume();
+      const pose& p = rp_.pose();
+      if (v.distance_to_walls(p.position()) <= step.center_distance())
+	return false;
+      vector center = p.position() + p.z_direction()*step.center_distance();
+      double r = v.distance_to_walls(center) - step.exit_distance()
+	- v.small_step();
+      if (r*step.transport_coefficient() < diffusion_radius_)
+	return false;
+      step.jump(rp_, rnd_, r);
+      if (statistics())
+	statistics()->diffusion_steps++;
+      return true;
+    }
+    double force_collision(material::base& material,
+			   const compiled_material* cm,
+			   double scattering_optical_depth)
+    // Banks the part of rp_ reaching the next wall without scattering
+    // and returns a scattering optical depth before the wall for the
+    // rest, or leaves rp_ as is in media without scattering
+    {
+      material_interactor mi(rp_,material,rnd_,scattering_optical_depth,
+			     0,scattering_sampling_,cm);
+      if (truncates_)
+	mi.truncate_forward_peak();
+      double tau = mi.scattering_optical_depth(distance_to_wall(intersection_));
+      if (!(tau > 0))
+	return scattering_optical_depth;
+      forces_collision_ = false;
+      double p = -expm1(-tau);
+      radiation_package uncollided = rp_;
+      uncollided.scale_intensity(1-p);
+      bank_.push_back({uncollided, &nav_.current_volume(), tau-log(rnd_(0,1)),
+	  false, truncates_});
+      rp_.scale_intensity(p);
+      // Kept clear of the wall against rounding
+      return std::min(-log1p(-p*rnd_(0,1)), tau*(1-1e-9));
+    }
+    void apply_weight_window() {
+      bool had_weight = rp_.weight() > 0;
+      weight_window_.play_russian_roulette(rp_, rnd_);
+      if (statistics() && had_weight && !(rp_.weight() > 0))
+	statistics()->roulette_kills++;
+      size_t n = weight_window_.split(rp_);
+      for (size_t i=1; i<n; ++i)
+	bank_.push_back({rp_, &nav_.current_volume(), -log(rnd_(0,1)),
+	    false, truncates_});
+    }
+    void compile_medium(const emitter& em)
+    // One snapshot for monochromatic packages, or one for each hero
+    // wavelength of spectral packages
+    {
+      snapshots_.clear();
+      snapshot_ = nullptr;
+      if (!uses_compiled_medium_)
+	return;
+      bool with_phase_tables =
+	(scattering_sampling_ == scattering_sampling::phase_function);
+      if (!em.is_spectral()) {
+	snapshots_.emplace_back(outer_volume_, with_phase_tables);
+	return;
+      }
+      for (size_t i=0; i<em.wavelengths().size(); ++i) {
+	for (auto c : spectral_contents_)
+	  c->select_wavelength(i);
+	snapshots_.emplace_back(outer_volume_, with_phase_tables);
+      }
+    }
+    void prepare_spectrum(const emitter& em)
+    // Spectral emitters need material copies at each emitted
+    // wavelength in all volumes
+    {
+      spectral_contents_.clear();
+      prepare_spectrum(em, outer_volume_);
+    }
+    void prepare_spectrum(const emitter& em, geometry::volume<flick::content>& v) {
+      flick::content& c = v.content();
+      if (em.is_spectral()) {
+	if (!c.has_material())
+	  c.fill<material::vacuum>();
+	c.set_spectrum(em.wavelengths());
+	spectral_contents_.push_back(&c);
+      } else {
+	c.clear_spectrum();
+      }
+      for (size_t i=0; i<v.n_inner_volumes(); ++i)
+	prepare_spectrum(em, v.inner_volume(i));
+    }
+    void transport_in_parallel(const emitter& em,
+			       const std::string& emitter_volume_name,
+			       double sampling_asymmetry_factor) {
+      std::vector<emitter> parts = em.split(n_threads_);
+      std::vector<std::shared_ptr<ordinary_mc>> workers(n_threads_);
+      for (size_t i=0; i<n_threads_; ++i) {
+	workers[i] = std::make_shared<ordinary_mc>(worker_volume(outer_volume_));
+	workers[i]->rnd_ = next_worker_stream();
+	workers[i]->scattering_sampling_ = scattering_sampling_;
+	workers[i]->uses_compiled_medium_ = uses_compiled_medium_;
+	workers[i]->set_weight_window(weight_window_);
+	workers[i]->collects_statistics_ = collects_statistics_;
+	workers[i]->is_adjoint_ = is_adjoint_;
+	workers[i]->forces_first_collision_ = forces_first_collision_;
+	workers[i]->directional_bias_ = directional_bias_;
+	workers[i]->peak_truncation_ = peak_truncation_;
+	workers[i]->diffusion_radius_ = diffusion_radius_;
+	workers[i]->quasi_random_ = quasi_random_;
+	workers[i]->n_quasi_random_points_ = n_quasi_random_points_;
+	n_quasi_random_points_ += parts[i].packages_left();
+	for (auto& d : detectors_) {
+	  workers[i]->detectors_.push_back(d->clone());
+	  workers[i]->detectors_.back()->clear();
+	}
+      }
+      std::vector<std::exception_ptr> errors(n_threads_);
+      std::vector<std::thread> threads;
+      for (size_t i=0; i<n_threads_; ++i) {
+	threads.emplace_back([&, i]() {
+	  try {
+	    workers[i]->transport_run(parts[i],emitter_volume_name,
+				      sampling_asymmetry_factor);
+	  } catch (...) {
+	    errors[i] = std::current_exception();
+	  }
+	});
+      }
+      for (auto& t : threads)
+	t.join();
+      for (auto& e : errors)
+	if (e)
+	  std::rethrow_exception(e);
+      for (size_t i=0; i<n_threads_; ++i) {
+	merge_receivers(outer_volume_, workers[i]->outer_volume_);
+	weight_window_.add_statistics(workers[i]->variance_reduction_statistics());
+	statistics_.add(workers[i]->statistics_);
+	for (size_t j=0; j<detectors_.size(); ++j)
+	  detectors_[j]->add(*workers[i]->detectors_[j]);
+      }
+    }
+    uniform_random next_worker_stream()
+    // Streams not used by this or earlier runs
+    {
+      return rnd_.stream(rnd_.stream_number() + ++n_worker_streams_);
     }
-  private:
     void exit_semi_infinite_volume() {
       nav_.go_outward();
     }
     double distance_to_wall(const std::optional<pose>& p) {
-      return norm((*p).position()-rp_.pose().position()); 
+      return norm((*p).position()-rp_.pose().position());
     }
   };
 }
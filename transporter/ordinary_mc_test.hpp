@@ -1,6 +1,14 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include "ordinary_mc.hpp"
 #include "../component/emitter.hpp"
 #include "../material/henyey_greenstein.hpp"
+#include "../material/fournier_forand.hpp"
+#include "../material/water/pure_water.hpp"
+#include "../material/gas/air.hpp"
+#include "../material/z_profile.hpp"
+#include "../numeric/units.hpp"
 
 namespace flick {
   begin_test_case(ordinary_mc_test_A) {
@@ -114,4 +122,706 @@ namespace flick {
     check_close(reflectance,r_benchmark,5.0_pct);
     check_close(transmittance,t_benchmark,7.0_pct);
   } end_test_case()
+
+  begin_test_case(ordinary_mc_test_F) {
+    double r = 1;
+    sphere s(r);
+    s.name("s");
+    s().outward_receiver().activate();
+    absorption_coefficient a{0.1};
+    scattering_coefficient b{1};
+    asymmetry_factor g{0.5};
+    s().fill<material::henyey_greenstein>(a,b,g);
+    size_t n = 2000;
+    emitter emitter{n};
+    emitter.set_direction<isotropic>();
+    auto flux = [&](size_t n_threads, unsigned seed) {
+      transporter::ordinary_mc omc{s};
+      omc.set_seed(seed);
+      omc.set_threads(n_threads);
+      omc.transport_radiation(emitter,"s",g());
+      check(omc.outward_receiver("s").received_packages() == n);
+      return omc.outward_receiver("s").radiant_flux();
+    };
+    double f1 = flux(1,1);
+    check(f1 == flux(1,1),"reproducible single thread");
+    double f4 = flux(4,1);
+    check(f4 == flux(4,1),"reproducible four threads");
+    check_close(f4,f1,5.0_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_G) {
+    double r = 1;
+    sphere s(r);
+    s.name("s");
+    s().outward_receiver().activate();
+    s().fill<material::fournier_forand>(absorption_coefficient{0},
+					scattering_coefficient{2},
+					asymmetry_factor{0.95});
+    size_t n = 1000;
+    emitter emitter{n};
+    emitter.set_direction<isotropic>();
+    transporter::ordinary_mc omc{s};
+    omc.set_seed(1);
+    omc.set_scattering_sampling(transporter::scattering_sampling::phase_function);
+    omc.transport_radiation(emitter,"s");
+    check_close(omc.outward_receiver("s").radiant_flux(),n,0.5_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_H) {
+    // Each wavelength carried by spectral packages should give the
+    // flux of a monochromatic run
+    std::vector<double> wl{400e-9,500e-9,600e-9,700e-9};
+    double r = 3;
+    sphere s(r);
+    s.name("s");
+    s().outward_receiver().activate();
+    s().fill<material::pure_water>();
+    size_t n = 4000;
+    emitter em{n};
+    em.set_spectrum(pp_function{{300e-9,800e-9},{1,1}}, wl);
+    transporter::ordinary_mc omc{s};
+    omc.set_seed(1);
+    omc.transport_radiation(em,"s");
+    std::vector<double> f = omc.outward_receiver("s").spectral_radiant_flux();
+    check(f.size()==wl.size());
+    for (size_t i=0; i<wl.size(); ++i) {
+      sphere s_mono(r);
+      s_mono.name("s");
+      s_mono().outward_receiver().activate();
+      s_mono().fill<material::pure_water>();
+      s_mono().material().set_wavelength(wl[i]);
+      emitter em_mono{n/wl.size()};
+      em_mono.set_wavelength<monocromatic>(wl[i]);
+      transporter::ordinary_mc omc_mono{s_mono};
+      omc_mono.set_seed(2);
+      omc_mono.transport_radiation(em_mono,"s");
+      check_close(f[i],omc_mono.outward_receiver("s").radiant_flux(),2.0_pct);
+    }
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_I) {
+    // Roulette and splitting should not change the received flux
+    auto flux = [this](bool variance_reduction) {
+      sphere outer(2);
+      outer.name("outer");
+      sphere s(1);
+      s.name("s");
+      s().outward_receiver().activate();
+      s().fill<material::henyey_greenstein>(1.0,5.0,0.8,1.33);
+      outer.insert(s);
+      size_t n = 4000;
+      emitter emitter{n};
+      emitter.set_direction<isotropic>();
+      transporter::ordinary_mc omc{outer};
+      omc.set_seed(1);
+      if (variance_reduction) {
+	omc.set_russian_roulette(0.1,0.3);
+	omc.set_splitting(0.6,3);
+	omc.set_interface_splitting(true);
+      }
+      omc.transport_radiation(emitter,"s");
+      transporter::weight_window_statistics st = omc.variance_reduction_statistics();
+      check(variance_reduction == (st.roulette_games > 0));
+      check(st.roulette_kills <= st.roulette_games);
+      check(variance_reduction == (st.splittings > 0));
+      check(variance_reduction == (st.interface_splittings > 0));
+      return omc.outward_receiver("s").radiant_flux()/n;
+    };
+    check_close(flux(true),flux(false),2.0_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_J) {
+    // Radiance from a thin slab with isotropic scattering. Single
+    // scattering gives L = s/(4*pi*mu)*(1-exp(-k*h))/k where
+    // k = s*(1+1/mu).
+    double h = 1;
+    double s = 0.01;
+    semi_infinite_box geometry;
+    semi_infinite_box slab;
+    semi_infinite_box bottom;
+    geometry.name("geometry");
+    slab.name("slab");
+    bottom.name("bottom");
+    slab().fill<material::henyey_greenstein>(0.0,s,0.0);
+    bottom().coat<coating::grey_lambert>(0.0,1.0);
+    geometry.move_by({0,0,h+1});
+    slab.move_by({0,0,h});
+    slab.insert(bottom);
+    geometry.insert(slab);
+    size_t n = 100000;
+    emitter em{{0,0,h+0.5},n};
+    em.set_direction<unidirectional>(unit_vector{constants::pi,0});
+    transporter::ordinary_mc omc{geometry};
+    omc.set_seed(1);
+    double theta = 0.5;
+    direction_detector& d = omc.add_detector<direction_detector>(unit_vector{theta,0});
+    omc.transport_radiation(em,"geometry",0);
+    double mu = cos(theta);
+    double k = s*(1+1/mu);
+    double L = s/(4*constants::pi*mu)*(1-exp(-k*h))/k;
+    check_close(d.radiance()/n,L,6.0_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_K) {
+    // Embedded volumes of the container's own material, found through
+    // the bounding volume hierarchy, should not change the flux out
+    // of the container
+    auto flux = [&](size_t m) {
+      sphere container(160);
+      container.name("container");
+      container().fill<material::henyey_greenstein>(0.001,0.05,0.8);
+      container().outward_receiver().activate();
+      double step = 180.0/m;
+      for (size_t i=0; i<m*m*m; ++i) {
+	sphere s(0.3*step);
+	s.move_by({-90+step*(i%m+0.5), -90+step*(i/m%m+0.5), -90+step*(i/m/m+0.5)});
+	s().fill<material::henyey_greenstein>(0.001,0.05,0.8);
+	container.insert(s);
+      }
+      size_t n = 2000;
+      emitter em{n};
+      em.set_direction<isotropic>();
+      transporter::ordinary_mc omc{container};
+      omc.set_seed(1);
+      omc.transport_radiation(em,"container");
+      check(omc.outward_receiver("container").received_packages() == n);
+      return omc.outward_receiver("container").radiant_flux()/n;
+    };
+    check_close(flux(8), flux(0), 2_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_L) {
+    // The compiled medium should give the same packages as calling
+    // the materials at every step. Phase tables are tabulated at
+    // another pose, with differences at rounding level that make
+    // paths diverge, so the flux is equal only within noise.
+    auto flux = [](bool compiled, transporter::scattering_sampling sampling) {
+      sphere outer(3);
+      outer.name("outer");
+      sphere s(2);
+      s.name("s");
+      s().outward_receiver().activate();
+      s().fill<material::henyey_greenstein>(0.2,2.0,0.8,1.33);
+      sphere core(1);
+      core.name("core");
+      core().fill<material::fournier_forand>(absorption_coefficient{0.1},
+					     scattering_coefficient{3},
+					     asymmetry_factor{0.9});
+      s.insert(core);
+      outer.insert(s);
+      emitter em{2000};
+      em.set_direction<isotropic>();
+      transporter::ordinary_mc omc{outer};
+      omc.set_seed(1);
+      omc.set_scattering_sampling(sampling);
+      omc.set_compiled_medium(compiled);
+      omc.transport_radiation(em,"core");
+      return omc.outward_receiver("s").radiant_flux();
+    };
+    using enum transporter::scattering_sampling;
+    check(flux(true,henyey_greenstein) == flux(false,henyey_greenstein));
+    check_close(flux(true,phase_function),flux(false,phase_function),3.0_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_M) {
+    // Packages streamed by receivers in several threads should all
+    // be in the file, carrying the flux of the tally
+    std::string file = "./tmp_omc_events.bin";
+    sphere s(1);
+    s.name("s");
+    s().outward_receiver().activate();
+    s().outward_receiver().use(tally());
+    s().outward_receiver().stream_to(std::make_shared<event_stream>(file));
+    s().fill<material::henyey_greenstein>(0.1,1.0,0.5,1.0);
+    size_t n = 20000;
+    emitter em{n};
+    em.set_direction<isotropic>();
+    transporter::ordinary_mc omc{s};
+    omc.set_seed(1);
+    omc.set_threads(4);
+    omc.transport_radiation(em,"s");
+    receiver& re = omc.outward_receiver("s");
+    {
+      event_file ef(file);
+      check(ef.size() == re.received_packages());
+      double flux = 0;
+      for (size_t b=0; b<ef.n_blocks(); ++b) {
+	const double* I = ef.column(b, event_column::I);
+	const double* w = ef.column(b, event_column::spectral_weight);
+	for (size_t i=0; i<ef.block_size(b); ++i)
+	  flux += I[i]*w[i];
+      }
+      check_close(flux, re.radiant_flux(), 1e-9_pct);
+    }
+    std::filesystem::remove(file);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_N) {
+    // Statistics should count every package termination once, and
+    // not change the transport
+    auto run = [](bool statistics, double albedo) {
+      sphere s(1);
+      s.name("s");
+      s().outward_receiver().activate();
+      s().fill<material::henyey_greenstein>(0.1,1.0,0.5,1.0);
+      if (albedo > 0)
+	s().coat<coating::grey_lambert>(albedo,0);
+      emitter em{2000};
+      em.set_direction<isotropic>();
+      auto omc = std::make_shared<transporter::ordinary_mc>(s);
+      omc->set_seed(1);
+      omc->set_threads(2);
+      omc->collect_statistics(statistics);
+      omc->transport_radiation(em,"s");
+      return omc;
+    };
+    auto plain = run(false,0);
+    auto counted = run(true,0);
+    check(plain->outward_receiver("s").radiant_flux()
+	  == counted->outward_receiver("s").radiant_flux());
+    check(plain->event_statistics().packages == 0);
+    const transporter::transport_statistics& s = counted->event_statistics();
+    if constexpr (transporter::has_transport_statistics) {
+      check(s.packages == 2000);
+      check(s.terminations() == s.packages);
+      check(s.escaped == s.transmissions);
+      check(s.scattering_events > 0);
+      check(s.mean_steps() > 1);
+      check(s.seconds(transporter::transport_phase::material) > 0);
+      check(s.seconds(transporter::transport_phase::receiver) > 0);
+    }
+    auto walled = run(true,0.5);
+    const transporter::transport_statistics& w = walled->event_statistics();
+    if constexpr (transporter::has_transport_statistics) {
+      check(w.escaped == 0);
+      check(w.absorbed_at_walls > 0);
+      check(w.terminations() == w.packages);
+      check(w.wall_interactions() == w.reflections + w.absorbed_at_walls);
+    }
+  } end_test_case()
+
+  struct rayleigh_scatterer : public material::henyey_greenstein
+  // Polarizing scatterer for comparing forward and adjoint runs
+  {
+    using material::henyey_greenstein::henyey_greenstein;
+    std::shared_ptr<material::base> clone() const override {
+      return std::make_shared<rayleigh_scatterer>(*this);
+    }
+    mueller mueller_matrix(const unit_vector& d) const {
+      return rayleigh_mueller(angle(d),0);
+    }
+  };
+
+  template<class Setup>
+  semi_infinite_box slab_over_bottom(Setup setup)
+  // Volume named geometry up to height 2, holding a slab from height
+  // 1 down to a bottom at 0. Setup is called with the contents of the
+  // slab and the bottom to fill and coat them.
+  {
+    semi_infinite_box geometry, slab, bottom;
+    geometry.name("geometry");
+    slab.name("slab");
+    bottom.name("bottom");
+    setup(slab(), bottom());
+    geometry.move_by({0,0,2});
+    slab.move_by({0,0,1});
+    slab.insert(bottom);
+    geometry.insert(slab);
+    return geometry;
+  }
+
+  void transport_from_above(transporter::ordinary_mc& omc, size_t n,
+			    double sampling_asymmetry_factor,
+			    const unit_vector& direction =
+			    unit_vector{constants::pi-0.5,0})
+  // Collimated packages emitted at height 1.5 of slab_over_bottom
+  {
+    emitter em{{0,0,1.5},n};
+    em.set_direction<unidirectional>(direction);
+    omc.transport_radiation(em,"geometry",sampling_asymmetry_factor);
+  }
+
+  begin_test_case(ordinary_mc_test_O) {
+    // Adjoint runs from the detector should agree with forward runs
+    // from the source, also through polarizing multiple scattering
+    // and reflection at a Lambert bottom
+    unit_vector source{constants::pi-0.7,0};
+    unit_vector view{0.5,1.0};
+    for (double albedo : {0.0, 0.5}) {
+      auto geometry = slab_over_bottom([&](content& slab, content& bottom) {
+	slab.fill<rayleigh_scatterer>(0.1,1.0,0.0);
+	bottom.coat<coating::grey_lambert>(albedo,1-albedo);
+      });
+      size_t n = 20000;
+      transporter::ordinary_mc forward{geometry};
+      forward.set_seed(1);
+      auto& d = forward.add_detector<direction_detector>(view);
+      transport_from_above(forward, n, 0, source);
+      transporter::ordinary_mc adjoint{geometry};
+      adjoint.set_seed(2);
+      adjoint.set_threads(2);
+      emitter ea{{0,0,1.5},n};
+      ea.set_direction<unidirectional>(-view);
+      double radiance = adjoint.transport_adjoint(ea,"geometry",source,0);
+      check_close(radiance, d.radiance()/n, 5_pct);
+    }
+    semi_infinite_box geometry;
+    geometry.name("geometry");
+    transporter::ordinary_mc adjoint{geometry};
+    emitter spectral{{0,0,1.5},1};
+    spectral.set_spectrum(pp_function{{300e-9,800e-9},{1,1}}, {400e-9,500e-9});
+    check_throw(adjoint.transport_adjoint(spectral,"geometry",source));
+  } end_test_case()
+
+  struct interrupting_detector : public point_detector
+  // Throws after a given number of scores, as a stopped job would
+  // stop transport
+  {
+    static inline std::atomic<long> scores_left{-1};
+    using point_detector::point_detector;
+    std::shared_ptr<detector> clone() const override {
+      return std::make_shared<interrupting_detector>(*this);
+    }
+    double geometric_factor(const vector& position) const {
+      if (scores_left-- == 0)
+	throw std::runtime_error("interrupted");
+      return point_detector::geometric_factor(position);
+    }
+  };
+
+  begin_test_case(ordinary_mc_test_P) {
+    // A run continued from its last checkpoint should give the
+    // results of an uninterrupted run, and a checkpoint of the run
+    // with other threads should not be continued
+    std::string file = (std::filesystem::temp_directory_path()
+			/ "ordinary_mc_test_P.bin").string();
+    auto run = [&](size_t n_threads, bool checkpointed, long scores) {
+      sphere s(1);
+      s.name("s");
+      s().outward_receiver().activate();
+      s().outward_receiver().use(tally{});
+      s().fill<material::henyey_greenstein>(0.1,1.0,0.5,1.0);
+      emitter em{2000};
+      em.set_direction<isotropic>();
+      transporter::ordinary_mc omc(s);
+      omc.set_seed(1);
+      omc.set_threads(n_threads);
+      auto& d = omc.add_detector<interrupting_detector>(vector{0,0,3});
+      if (checkpointed)
+	omc.set_checkpoint({file, 300});
+      interrupting_detector::scores_left = scores;
+      try {
+	omc.transport_radiation(em,"s");
+      } catch (const std::runtime_error&) {
+	return std::make_pair(0.0, 0.0);
+      }
+      return std::make_pair(omc.outward_receiver("s").radiant_flux(),
+			    d.fluence_rate());
+    };
+    auto plain = run(1, false, -1);
+    auto serial = run(1, true, -1);
+    std::filesystem::remove(file);
+    check(plain == serial);
+    const long many = 1000000;
+    auto full = run(2, true, many);
+    long n_scores = many - interrupting_detector::scores_left;
+    std::filesystem::remove(file);
+    run(2, true, n_scores/2);
+    check(std::filesystem::exists(file));
+    check(run(3, true, many) == std::make_pair(0.0, 0.0));
+    auto resumed = run(2, true, many);
+    check(resumed == full);
+    check(many - interrupting_detector::scores_left < n_scores);
+    check(run(2, true, 0) == full);
+    std::filesystem::remove(file);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_Q) {
+    // Forced first collisions and scattering biased toward a
+    // direction should not change results, and should let thin
+    // media scatter every package
+    auto run = [&](double tau, bool forced, bool biased,
+		  double* radiance = nullptr) {
+      unit_vector view{0.3,0};
+      auto geometry = slab_over_bottom([&](content& slab, content& bottom) {
+	slab.fill<material::henyey_greenstein>(0.0,tau,0.7);
+	slab.outward_receiver().activate();
+	slab.outward_receiver().use(tally().radiance_cone(view,0.2));
+	bottom.coat<coating::grey_lambert>(0.0,1.0);
+      });
+      size_t n = 20000;
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(1);
+      omc.collect_statistics(true);
+      omc.force_first_collision(forced);
+      if (biased)
+	omc.set_directional_bias(view,0.5);
+      auto& d = omc.add_detector<direction_detector>(view);
+      transport_from_above(omc, n, 0.7);
+      if (forced && transporter::has_transport_statistics)
+	check(omc.event_statistics().scattering_events >= n);
+      auto& r = omc.outward_receiver("slab");
+      if (radiance)
+	*radiance = biased ? r.radiance(view,0.2)/n : d.radiance()/n;
+      return r.radiant_flux()/n;
+    };
+    check_close(run(0.5,true,false), run(0.5,false,false), 3_pct);
+    double plain, forced_biased;
+    run(0.05,false,false,&plain);
+    run(0.05,true,true,&forced_biased);
+    check_close(forced_biased, plain, 10_pct);
+    semi_infinite_box box;
+    transporter::ordinary_mc omc{box};
+    check_throw(omc.set_directional_bias(unit_vector{0,0},1.5));
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_R) {
+    // Delta-scaled transport should keep fluxes of thick forward
+    // scattering media with far fewer scattering events, and radiance
+    // in the forward peak when the first scattering is kept
+    auto run = [](double tau, transporter::peak_truncation t,
+		  bool has_bottom, const unit_vector& view, size_t n) {
+      auto geometry = slab_over_bottom([&](content& slab, content& bottom) {
+	slab.fill<material::henyey_greenstein>(0.0,tau,0.9);
+	slab.outward_receiver().activate();
+	if (has_bottom)
+	  bottom.coat<coating::grey_lambert>(0.0,1.0);
+      });
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(1);
+      omc.collect_statistics(true);
+      omc.truncate_forward_peaks(t);
+      auto& d = omc.add_detector<direction_detector>(view);
+      transport_from_above(omc, n, 0.9);
+      return std::array<double,3>{omc.outward_receiver("slab").radiant_flux()/n,
+	d.radiance()/n, double(omc.event_statistics().scattering_events)/n};
+    };
+    using enum transporter::peak_truncation;
+    unit_vector up{0.3,0};
+    auto plain = run(10, none, true, up, 5000);
+    auto scaled = run(10, delta_scaled, true, up, 5000);
+    check_close(scaled[0], plain[0], 5_pct);
+    if (transporter::has_transport_statistics)
+      check(scaled[2] < plain[2]/4);
+    unit_vector aureole{constants::pi-0.3,0};
+    auto forward = run(1, none, false, aureole, 10000);
+    auto truncated = run(1, delta_scaled, false, aureole, 10000);
+    auto restored = run(1, after_first_scattering, false, aureole, 10000);
+    check(truncated[1] < forward[1]/5);
+    check_close(restored[1], forward[1], 15_pct);
+    check_close(restored[0], forward[0], 5_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_S) {
+    // Diffusion steps deep inside a thick slab should keep its
+    // reflectance with far fewer scattering events
+    check_close(transporter::diffusion_step::first_passage().mean(), 1.0/6, 1_pct);
+    auto run = [](double minimum_radius) {
+      auto geometry = slab_over_bottom([](content& slab, content&) {
+	slab.fill<material::henyey_greenstein>(0.5,50,0.8);
+	slab.outward_receiver().activate();
+      });
+      size_t n = 4000;
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(1);
+      omc.collect_statistics(true);
+      omc.set_diffusion_steps(minimum_radius);
+      transport_from_above(omc, n, 0.8);
+      const transporter::transport_statistics& s = omc.event_statistics();
+      return std::array<double,3>{omc.outward_receiver("slab").radiant_flux()/n,
+	double(s.scattering_events)/n, double(s.diffusion_steps)/n};
+    };
+    auto plain = run(0);
+    auto diffusing = run(2);
+    check_close(diffusing[0], plain[0], 3_pct);
+    if (transporter::has_transport_statistics) {
+      check(diffusing[1] < 0.7*plain[1]);
+      check(diffusing[2] > 1);
+      check(plain[2] == 0);
+    }
+    semi_infinite_box box;
+    box.name("box");
+    transporter::ordinary_mc omc{box};
+    check_throw(omc.set_diffusion_steps(-1));
+    omc.set_diffusion_steps(2);
+    omc.add_detector<direction_detector>(unit_vector{0,0});
+    emitter em{{0,0,-1},1};
+    check_throw(omc.transport_radiation(em,"box"));
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_T) {
+    // Runs with quasi-random packages should agree with pseudo-random
+    // ones and spread less
+    auto run = [](size_t n_dimensions, size_t n_threads) {
+      auto geometry = slab_over_bottom([](content& slab, content&) {
+	slab.fill<material::henyey_greenstein>(0.1,0.5,0.6);
+	slab.outward_receiver().activate();
+      });
+      size_t n = 1024;
+      size_t n_runs = 16;
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(2);
+      omc.set_threads(n_threads);
+      omc.set_quasi_random(n_dimensions);
+      std::vector<double> r;
+      double previous = 0;
+      for (size_t i=0; i<n_runs; ++i) {
+	transport_from_above(omc, n, 0.6);
+	double current = omc.outward_receiver("slab").radiant_flux();
+	r.push_back((current-previous)/n);
+	previous = current;
+      }
+      double mean = 0;
+      for (double x : r)
+	mean += x/n_runs;
+      double s = 0;
+      for (double x : r)
+	s += (x-mean)*(x-mean);
+      return std::array<double,2>{mean, sqrt(s/(n_runs-1))};
+    };
+    auto plain = run(0, 1);
+    auto quasi = run(16, 1);
+    auto threaded = run(16, 2);
+    check_close(quasi[0], plain[0], 5_pct);
+    check_close(threaded[0], plain[0], 5_pct);
+    check(quasi[1] < 0.7*plain[1]);
+    semi_infinite_box box;
+    transporter::ordinary_mc omc{box};
+    check_throw(omc.set_quasi_random(sobol_sequence::max_dimensions+1));
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_U) {
+    // Threads transport through clones of the materials, which
+    // should keep the Rayleigh scattering of air
+    using namespace units;
+    atmospheric_state state(290_K, 1000_hPa, 8);
+    state.remove_all_gases();
+    material::hitran_air air(state);
+    check(dynamic_cast<material::hitran_air*>(air.clone().get()) != nullptr);
+    double h = 100_km;
+    semi_infinite_box geometry;
+    semi_infinite_box slab;
+    semi_infinite_box bottom;
+    geometry.name("geometry");
+    slab.name("slab");
+    bottom.name("bottom");
+    slab().fill<material::hitran_air>(state);
+    slab().material().set_wavelength(400_nm);
+    bottom().coat<coating::grey_lambert>(0.0,1.0);
+    geometry.move_by({0,0,h+1});
+    slab.move_by({0,0,h});
+    slab.insert(bottom);
+    geometry.insert(slab);
+    auto radiance = [&](size_t n_threads) {
+      size_t n = 20000;
+      emitter em{{0,0,h+0.5},n};
+      em.set_direction<unidirectional>(unit_vector{constants::pi,0});
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(1);
+      omc.set_threads(n_threads);
+      direction_detector& d = omc.add_detector<direction_detector>(unit_vector{0.5,0});
+      omc.transport_radiation(em,"geometry",0);
+      return d.radiance()/n;
+    };
+    check_close(radiance(2), radiance(1), 3_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_V) {
+    // Copies split off by the weight window should keep the delta
+    // scaling of the package, so splitting leaves the truncated
+    // forward peak out of the radiance
+    auto radiance = [](bool splits) {
+      auto geometry = slab_over_bottom([](content& slab, content&) {
+	slab.fill<material::henyey_greenstein>(0.0,1.0,0.9);
+      });
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(1);
+      omc.truncate_forward_peaks(transporter::peak_truncation::delta_scaled);
+      if (splits)
+	omc.set_splitting(0.1,4);
+      auto& d = omc.add_detector<direction_detector>(unit_vector{constants::pi-0.3,0});
+      size_t n = 10000;
+      transport_from_above(omc, n, 0.9);
+      return d.radiance()/n;
+    };
+    check_close(radiance(true), radiance(false), 10_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_W) {
+    // Light reflected by a Lambert bottom should reach direction
+    // detectors, also when refracted out of the slab, as it reaches
+    // receivers
+    auto run = [](double n_slab, double s, size_t n, double* cone) {
+      unit_vector view{0.4,0.5};
+      semi_infinite_box geometry, air, slab, bottom;
+      geometry.name("geometry");
+      air.name("air");
+      slab.name("slab");
+      bottom.name("bottom");
+      air().outward_receiver().activate();
+      air().outward_receiver().use(tally().radiance_cone(view,0.2));
+      slab().fill<material::henyey_greenstein>(0.2,s,0.5,n_slab);
+      bottom().coat<coating::grey_lambert>(0.5,0.0);
+      geometry.move_by({0,0,3});
+      air.move_by({0,0,2});
+      slab.move_by({0,0,1});
+      slab.insert(bottom);
+      air.insert(slab);
+      geometry.insert(air);
+      transporter::ordinary_mc omc{geometry};
+      omc.set_seed(1);
+      auto& d = omc.add_detector<direction_detector>(view);
+      emitter em{{0,0,2.5},n};
+      em.set_direction<unidirectional>(unit_vector{constants::pi-0.5,0});
+      omc.transport_radiation(em,"geometry",0.5);
+      if (cone)
+	*cone = omc.outward_receiver("air").radiance(view,0.2)/n;
+      return d.radiance()/n;
+    };
+    double lambert = 0.5/constants::pi*exp(-0.2/cos(0.5)-0.2/cos(0.4));
+    check_close(run(1.0, 0.0, 100, nullptr), lambert, 1e-6);
+    double cone;
+    double refracted = run(1.33, 0.0, 40000, &cone);
+    check_close(refracted, cone, 10_pct);
+    double scattered = run(1.33, 0.5, 40000, &cone);
+    check_close(scattered, cone, 10_pct);
+  } end_test_case()
+
+  begin_test_case(ordinary_mc_test_X) {
+    // Materials that change with height should be compiled to optical
+    // depths that are those of the material at the tabulated heights,
+    // and give the same flux within noise
+    auto profile = []() {
+      auto hg = std::make_shared<material::henyey_greenstein>(0.2,2.0,0.8,1.33);
+      return material::make_scaled_z_profile<pe_function>(hg,{-2,0,2},{0.3,1,3});
+    };
+    sphere s(2);
+    s().fill(profile());
+    transporter::medium_snapshot snapshot(s, false);
+    const transporter::compiled_material* cm = snapshot.find(s);
+    check(cm != nullptr && !cm->is_homogeneous());
+    material::base& m = s().material();
+    m.set(pose{vector{0,0,-1.5},unit_vector{0,0,1}});
+    check_close(cm->scattering_optical_depth(-1.5,1,3), m.scattering_optical_depth(3), 1e-9);
+    check_close(cm->absorption_optical_depth(-1.5,1,3), m.absorption_optical_depth(3), 1e-9);
+    m.set(pose{vector{0,0,-0.5},unit_vector{2*constants::pi/3,0}});
+    double tau = m.scattering_optical_depth(2);
+    check_close(cm->scattering_optical_depth(-0.5,-0.5,2), tau, 1e-9);
+    check_close(cm->scattering_distance(-0.5,-0.5,tau), 2, 1e-9);
+    auto flux = [&](bool compiled) {
+      sphere outer(2);
+      outer.name("outer");
+      outer().outward_receiver().activate();
+      outer().fill(profile());
+      emitter em{{0,0,1},20000};
+      em.set_direction<isotropic>();
+      transporter::ordinary_mc omc{outer};
+      omc.set_seed(1);
+      omc.set_compiled_medium(compiled);
+      omc.transport_radiation(em,"outer");
+      return omc.outward_receiver("outer").radiant_flux();
+    };
+    check_close(flux(true), flux(false), 2.0_pct);
+  } end_test_case()
 }
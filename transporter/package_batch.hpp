@@ -0,0 +1,136 @@
+#ifndef flick_package_batch
+#define flick_package_batch
+
+#include <vector>
+#include "../numeric/vector.hpp"
+#include "../numeric/simd.hpp"
+
+namespace flick {
+namespace transporter {
+  struct plane_package
+  // Unpolarized package in plane-parallel geometry
+  {
+    double x;
+    double y;
+    double z;
+    double ux;
+    double uy;
+    double uz;
+    double weight;
+    double traveling_length;
+    size_t layer;
+    double wavelength;
+    unit_vector emission_direction;
+  };
+
+  class package_batch
+  // Packages stored as one array per property, so that steps taken by
+  // all packages of the batch run over contiguous memory. The arrays
+  // are padded to whole SIMD registers. Padding holds copies of
+  // earlier packages, which may be stepped but are never read back.
+  {
+    size_t size_{0};
+  public:
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+    std::vector<double> ux;
+    std::vector<double> uy;
+    std::vector<double> uz;
+    std::vector<double> weight;
+    std::vector<double> traveling_length;
+    std::vector<double> scattering_optical_depth;
+    std::vector<size_t> layer;
+    std::vector<double> wavelength;
+    std::vector<unit_vector> emission_direction;
+    size_t size() const {
+      return size_;
+    }
+    size_t padded_size() const {
+      return weight.size();
+    }
+    bool empty() const {
+      return size_ == 0;
+    }
+    void push_back(const plane_package& p, double tau) {
+      if (size_ == padded_size())
+	resize(size_ + width());
+      set(size_, p);
+      wavelength[size_] = p.wavelength;
+      emission_direction[size_] = p.emission_direction;
+      scattering_optical_depth[size_] = tau;
+      size_++;
+    }
+    plane_package package(size_t i) const {
+      return {x[i], y[i], z[i], ux[i], uy[i], uz[i], weight[i],
+	traveling_length[i], layer[i], wavelength[i], emission_direction[i]};
+    }
+    void set(size_t i, const plane_package& p)
+    // Position, direction, weight, traveling length and layer
+    {
+      x[i] = p.x;
+      y[i] = p.y;
+      z[i] = p.z;
+      ux[i] = p.ux;
+      uy[i] = p.uy;
+      uz[i] = p.uz;
+      weight[i] = p.weight;
+      traveling_length[i] = p.traveling_length;
+      layer[i] = p.layer;
+    }
+    void remove_empty(double min_weight)
+    // Removes packages with weight below min_weight and moves the rest
+    // forward, keeping their order
+    {
+      size_t n = 0;
+      for (size_t i=0; i<size_; ++i) {
+	if (!(weight[i] >= min_weight))
+	  continue;
+	if (n != i) {
+	  x[n] = x[i];
+	  y[n] = y[i];
+	  z[n] = z[i];
+	  ux[n] = ux[i];
+	  uy[n] = uy[i];
+	  uz[n] = uz[i];
+	  weight[n] = weight[i];
+	  traveling_length[n] = traveling_length[i];
+	  scattering_optical_depth[n] = scattering_optical_depth[i];
+	  layer[n] = layer[i];
+	  wavelength[n] = wavelength[i];
+	  emission_direction[n] = emission_direction[i];
+	}
+	++n;
+      }
+      size_ = n;
+    }
+    void clear() {
+      size_ = 0;
+    }
+    static constexpr size_t width() {
+#if FLICK_SIMD
+      return simd::width;
+#else
+      return 1;
+#endif
+    }
+  private:
+    void resize(size_t n) {
+      x.resize(n);
+      y.resize(n);
+      z.resize(n);
+      ux.resize(n);
+      uy.resize(n);
+      uz.resize(n);
+      weight.resize(n);
+      traveling_length.resize(n);
+      scattering_optical_depth.resize(n);
+      layer.resize(n);
+      wavelength.resize(n);
+      emission_direction.resize(n, unit_vector{0,0});
+    }
+  };
+}
+}
+
+#endif
@@ -0,0 +1,668 @@
+#ifndef flick_plane_parallel_mc
+#define flick_plane_parallel_mc
+
+#include <thread>
+#include <exception>
+#include "wall_interactor.hpp"
+#include "material_interactor.hpp"
+#include "weight_window.hpp"
+#include "workers.hpp"
+#include "package_batch.hpp"
+#include "../material/material.hpp"
+
+namespace flick {
+namespace transporter {
+  class plane_parallel_mc
+  // Transport in plane-parallel geometry, given as semi-infinite
+  // boxes inside each other. Packages are followed by position,
+  // direction cosines and layer number, and walls are found from the
+  // heights of the layer tops instead of by navigating the volume
+  // tree. Materials, coatings, emitters and receivers are used as by
+  // ordinary_mc, but packages are unpolarized and monochromatic.
+  {
+    struct layer {
+      double top;
+      double bottom;
+      geometry::volume<flick::content>* volume;
+      const compiled_material* compiled;
+      std::complex<double> refractive_index;
+      bool has_plain_top;
+    };
+    using package = plane_package;
+    struct banked_package {
+      package p;
+      double scattering_optical_depth;
+    };
+    geometry::volume<flick::content> outer_volume_;
+    std::vector<layer> layers_;
+    uniform_random rnd_;
+    size_t n_threads_{1};
+    uint64_t n_worker_streams_{0};
+    scattering_sampling scattering_sampling_{scattering_sampling::henyey_greenstein};
+    henyey_greenstein hg_{0.8};
+    std::vector<banked_package> bank_;
+    transporter::weight_window weight_window_;
+    medium_snapshot snapshot_;
+    size_t batch_size_{1};
+    package_batch batch_;
+    std::vector<double> tops_;
+    std::vector<double> bottoms_;
+    std::vector<double> absorption_coefficients_;
+    std::vector<double> scattering_coefficients_;
+    static constexpr size_t n_phase_intervals_{4096};
+    std::vector<double> phase_functions_;
+    std::vector<double> random_numbers_;
+    std::vector<char> at_wall_;
+    std::vector<size_t> walls_;
+    std::vector<size_t> sorted_walls_;
+  public:
+    plane_parallel_mc(const geometry::volume<flick::content>& outer_volume)
+    // Each volume must be a semi-infinite box with at most one inner
+    // volume, placed lower than itself
+      : outer_volume_{outer_volume} {
+      find_layers();
+    }
+    plane_parallel_mc(const plane_parallel_mc&) = delete;
+    plane_parallel_mc& operator=(const plane_parallel_mc&) = delete;
+    void set_seed(uint64_t seed, uint64_t stream = 0)
+    // Makes runs reproducible for a given seed and number of
+    // threads. Threads use the streams following the given one, so
+    // independent processes with the same seed should start at
+    // streams far apart.
+    {
+      rnd_ = uniform_random(seed, stream);
+      n_worker_streams_ = 0;
+    }
+    void write_state(std::ostream& os)
+    // Random numbers drawn and receiver tallies, enough for an equal
+    // transporter to continue
+    {
+      rnd_.write_state(os);
+      write_binary(os, n_worker_streams_);
+      write_receivers(os, outer_volume_);
+      write_binary(os, weight_window_.statistics());
+    }
+    void read_state(std::istream& is) {
+      rnd_.read_state(is);
+      read_binary(is, n_worker_streams_);
+      read_receivers(is, outer_volume_);
+      weight_window_statistics w;
+      read_binary(is, w);
+      weight_window_.clear_statistics();
+      weight_window_.add_statistics(w);
+    }
+    void set_threads(size_t n_threads) {
+      if (n_threads < 1)
+	throw std::runtime_error("plane_parallel_mc threads");
+      n_threads_ = n_threads;
+    }
+    void set_scattering_sampling(scattering_sampling s) {
+      scattering_sampling_ = s;
+    }
+    void set_batch_size(size_t n)
+    // With n > 1, up to n packages are moved in lockstep, one step to
+    // the next scattering event or wall at a time. Free paths,
+    // absorption, scattering angles and turns are computed for whole
+    // SIMD registers of packages, and wall interactions follow in a
+    // separate pass, one package at a time. Phase functions are then
+    // read from tables of 4097 points. Batches are used when the build
+    // has SIMD, all layers are homogeneous and scattering angles are
+    // drawn from Henyey-Greenstein. Otherwise packages are followed
+    // one at a time.
+    {
+      if (n < 1)
+	throw std::runtime_error("plane_parallel_mc batch size");
+      batch_size_ = n;
+    }
+    void set_russian_roulette(double threshold, double survival_weight) {
+      weight_window_.set_russian_roulette(threshold, survival_weight);
+    }
+    void set_splitting(double threshold, size_t max_copies) {
+      weight_window_.set_splitting(threshold, max_copies);
+    }
+    void set_weight_window(const transporter::weight_window& ww)
+    // Splitting at interfaces is not available
+    {
+      if (ww.splits_at_interfaces())
+	throw std::runtime_error("plane_parallel_mc interface splitting");
+      weight_window_ = ww;
+      weight_window_.clear_statistics();
+    }
+    const weight_window_statistics& variance_reduction_statistics() const {
+      return weight_window_.statistics();
+    }
+    size_t n_layers() const {
+      return layers_.size();
+    }
+    flick::content& content(const std::string& volume_name) {
+      return layers_.at(layer_number(volume_name)).volume->content();
+    }
+    receiver& inward_receiver(const std::string& volume_name) {
+      return content(volume_name).inward_receiver();
+    }
+    receiver& outward_receiver(const std::string& volume_name) {
+      return content(volume_name).outward_receiver();
+    }
+    void transport_radiation(emitter em,
+			     const std::string& emitter_volume_name,
+			     double sampling_asymmetry_factor = 0.8) {
+      if (em.is_spectral())
+	throw std::runtime_error("plane_parallel_mc spectral");
+      if (n_threads_ > 1) {
+	transport_in_parallel(em, emitter_volume_name, sampling_asymmetry_factor);
+	return;
+      }
+      size_t n_start = layer_number(emitter_volume_name);
+      compile_medium();
+      hg_ = henyey_greenstein{sampling_asymmetry_factor};
+      if (uses_batches()) {
+	transport_in_batches(em, n_start, sampling_asymmetry_factor);
+	flush_receivers(outer_volume_);
+	return;
+      }
+      while (!em.is_empty()) {
+	bank_.push_back({emit(em, n_start), -log(rnd_(0,1))});
+	while (!bank_.empty()) {
+	  banked_package b = bank_.back();
+	  bank_.pop_back();
+	  transport_package(b.p, b.scattering_optical_depth);
+	}
+      }
+      flush_receivers(outer_volume_);
+    }
+  private:
+    package emit(emitter& em, size_t n_layer) {
+      radiation_package rp = em.emit(rnd_);
+      const pose& ep = rp.pose();
+      vector d = ep.z_direction();
+      return {ep.position().x(), ep.position().y(), ep.position().z(),
+	d.x(), d.y(), d.z(), rp.weight(), 0, n_layer, rp.wavelength(),
+	rp.emission_direction()};
+    }
+    void transport_package(package& p, double scattering_optical_depth)
+    // Follows p until it is empty or has left the layers. Packages
+    // split off on the way are put in the bank.
+    {
+      while (p.weight >= 1e-9) {
+	layer& l = layers_[p.layer];
+	double dw = distance_to_wall(p, l);
+	if (!std::isfinite(dw))
+	  return;
+	material::base& m = l.volume->content().material();
+	if (!l.compiled)
+	  m.set(pose{vector{p.x,p.y,p.z},unit_vector{p.ux,p.uy,p.uz}});
+	double ds = l.compiled ? l.compiled->scattering_distance(p.z, p.uz, scattering_optical_depth)
+	  : m.scattering_distance(scattering_optical_depth);
+	if (ds < dw) {
+	  absorb(p, l, m, ds);
+	  move(p, ds);
+	  scatter(p, l, m);
+	  scattering_optical_depth = -log(rnd_(0,1));
+	} else {
+	  absorb(p, l, m, dw);
+	  scattering_optical_depth -= l.compiled ? l.compiled->scattering_optical_depth(p.z, p.uz, dw)
+	    : m.scattering_optical_depth(dw);
+	  move(p, dw);
+	  if (!interact_with_wall(p))
+	    return;
+	  if (scattering_optical_depth <= 0)
+	    throw std::runtime_error("plane_parallel_mc");
+	}
+	apply_weight_window(p);
+      }
+    }
+    static double distance_to_wall(const package& p, const layer& l)
+    // Infinite when moving horizontally, or down in the lowest layer
+    {
+      if (p.uz > 0)
+	return (l.top-p.z)/p.uz;
+      if (p.uz < 0)
+	return (p.z-l.bottom)/(-p.uz);
+      return std::numeric_limits<double>::infinity();
+    }
+    static void move(package& p, double distance) {
+      p.x += p.ux*distance;
+      p.y += p.uy*distance;
+      p.z += p.uz*distance;
+      p.traveling_length += distance;
+    }
+    static void absorb(package& p, const layer& l, const material::base& m,
+		       double distance) {
+      double tau = l.compiled ? l.compiled->absorption_optical_depth(p.z, p.uz, distance)
+	: m.absorption_optical_depth(distance);
+      p.weight *= exp(-tau);
+    }
+    void scatter(package& p, const layer& l, material::base& m)
+    // Weighted by the phase function relative to the sampling density
+    {
+      // The phase function of homogeneous materials does not depend on
+      // where the package is
+      bool is_homogeneous = l.compiled && l.compiled->is_homogeneous();
+      if (!is_homogeneous)
+	m.set(pose{vector{p.x,p.y,p.z},unit_vector{p.ux,p.uy,p.uz}});
+      else
+	m.set(pose{});
+      double mu;
+      double sampling_density;
+      draw_scattering_mu(l, m, mu, sampling_density);
+      double phi = rnd_(0,2*constants::pi);
+      turn(p.ux, p.uy, p.uz, mu, phi);
+      unit_vector direction = is_homogeneous ? unit_vector{acos(mu),phi}
+	: unit_vector{p.ux,p.uy,p.uz};
+      p.weight *= m.mueller_matrix(direction).value(0,0)/sampling_density;
+    }
+    void draw_scattering_mu(const layer& l, const material::base& m,
+			    double& mu, double& sampling_density) {
+      if (scattering_sampling_ == scattering_sampling::phase_function) {
+	const tabulated_distribution& d = (l.compiled && l.compiled->scattering_mu)
+	  ? *l.compiled->scattering_mu : m.scattering_mu_distribution();
+	point s = d.quantile_and_pdf(rnd_(0,1));
+	mu = std::clamp<double>(s.x(),-1,1);
+	sampling_density = s.y()/(2*constants::pi);
+      } else {
+	double theta = hg_.inverted_accumulated_angle(rnd_(0,1));
+	mu = cos(theta);
+	sampling_density = hg_.phase_function(theta);
+      }
+    }
+    static void turn(double& ux, double& uy, double& uz, double mu, double phi)
+    // New direction at polar angle acos(mu) and azimuth phi from the
+    // old one
+    {
+      double sin_theta = sqrt(std::max(1-mu*mu, 0.0));
+      double cos_phi = cos(phi);
+      double sin_phi = sin(phi);
+      if (fabs(uz) > 1-1e-10) {
+	ux = sin_theta*cos_phi;
+	uy = sin_theta*sin_phi;
+	uz = (uz > 0) ? mu : -mu;
+      } else {
+	double s = sqrt(1-uz*uz);
+	double ux0 = ux;
+	double uy0 = uy;
+	ux = sin_theta*(ux0*uz*cos_phi-uy0*sin_phi)/s + ux0*mu;
+	uy = sin_theta*(uy0*uz*cos_phi+ux0*sin_phi)/s + uy0*mu;
+	uz = -sin_theta*cos_phi*s + uz*mu;
+      }
+    }
+    bool interact_with_wall(package& p)
+    // Crossing or reflection at the top of the layer below or of the
+    // current layer, with receivers and coating of the layer whose top
+    // is hit. False if the package leaves through the top of the
+    // outermost layer.
+    {
+      bool is_moving_down = p.uz < 0;
+      size_t n_wall = is_moving_down ? p.layer+1 : p.layer;
+      layer& w = layers_[n_wall];
+      flick::content& c = w.volume->content();
+      receiver& transmitted = is_moving_down ? c.inward_receiver() : c.outward_receiver();
+      receiver& reflected = is_moving_down ? c.outward_receiver() : c.inward_receiver();
+      p.z = w.top;
+      bool leaves = !is_moving_down && p.layer == 0;
+      if (w.has_plain_top) {
+	receive(transmitted, p);
+	if (leaves)
+	  return false;
+	p.layer = is_moving_down ? p.layer+1 : p.layer-1;
+	return true;
+      }
+      coating::base& cs = c.coating();
+      unit_vector d{p.ux,p.uy,p.uz};
+      cs.set_incidence(rotation{pose{vector{0,0,0},d}.rotation()});
+      cs.set(is_moving_down ? unit_vector{0,0,1} : unit_vector{0,0,-1});
+      unit_interval ui_polar{rnd_(0,1)};
+      unit_interval ui_azimuth{rnd_(0,1)};
+      cs.set_direction_parameters(ui_polar,ui_azimuth);
+      std::complex<double> m1 = layers_[p.layer].refractive_index;
+      std::complex<double> m2 = m1;
+      if (is_moving_down)
+	m2 = w.refractive_index;
+      else if (!leaves)
+	m2 = layers_[p.layer-1].refractive_index;
+      cs.set(m2/m1);
+      double r = rnd_(0,1);
+      double R = cs.unpolarized_reflectance();
+      double T = cs.unpolarized_transmittance();
+      if (r < R) {
+	p.weight *= cs.reflection_mueller_matrix().value(0,0)/R;
+	set_direction(p, cs.reflection_rotation().z_direction());
+	receive(reflected, p);
+      } else if (1-r < T) {
+	receive(transmitted, p);
+	p.weight *= cs.transmission_mueller_matrix().value(0,0)/T;
+	set_direction(p, cs.transmission_rotation().z_direction());
+	if (leaves)
+	  return false;
+	p.layer = is_moving_down ? p.layer+1 : p.layer-1;
+      } else {
+	receive(transmitted, p);
+	p.weight = 0;
+      }
+      return true;
+    }
+    static void set_direction(package& p, const unit_vector& d) {
+      p.ux = d.x();
+      p.uy = d.y();
+      p.uz = d.z();
+    }
+    void receive(receiver& r, const package& p)
+    // Received packages are made only for active receivers
+    {
+      if (!r.is_active())
+	return;
+      radiation_package rp{pose{vector{p.x,p.y,p.z},unit_vector{p.ux,p.uy,p.uz}},
+	stokes{p.weight,0,0,0}};
+      rp.wavelength(p.wavelength);
+      rp.emission_direction(p.emission_direction);
+      rp.traveling_length(p.traveling_length);
+      r.receive(rp);
+    }
+    void apply_weight_window(package& p) {
+      weight_window_.play_russian_roulette(p.weight, rnd_);
+      size_t n = weight_window_.split(p.weight);
+      for (size_t i=1; i<n; ++i)
+	bank_.push_back({p, -log(rnd_(0,1))});
+    }
+    bool uses_batches() const {
+      if (!has_simd || batch_size_ < 2
+	  || scattering_sampling_ != scattering_sampling::henyey_greenstein)
+	return false;
+      for (auto& l : layers_)
+	if (!l.compiled || !l.compiled->is_homogeneous())
+	  return false;
+      return true;
+    }
+    void transport_in_batches([[maybe_unused]] emitter& em,
+			      [[maybe_unused]] size_t n_start,
+			      [[maybe_unused]] double g)
+    // The batch is filled up with split and emitted packages before
+    // each step, and emptied packages are removed after it
+    {
+#if FLICK_SIMD
+      batch_.clear();
+      while (true) {
+	while (batch_.size() < batch_size_) {
+	  if (!bank_.empty()) {
+	    batch_.push_back(bank_.back().p, bank_.back().scattering_optical_depth);
+	    bank_.pop_back();
+	  } else if (!em.is_empty()) {
+	    batch_.push_back(emit(em, n_start), -log(rnd_(0,1)));
+	  } else {
+	    break;
+	  }
+	}
+	if (batch_.empty())
+	  return;
+	step_batch(g);
+	interact_with_walls();
+	for (size_t i=0; i<batch_.size(); ++i)
+	  if (batch_.weight[i] >= 1e-9)
+	    apply_weight_window(batch_, i);
+	batch_.remove_empty(1e-9);
+      }
+#endif
+    }
+#if FLICK_SIMD
+    void step_batch(double g)
+    // Moves each package of the batch to its next scattering event or
+    // wall, one SIMD register of packages at a time. Packages that
+    // scatter get new directions and free paths, and packages at walls
+    // are marked for interact_with_walls. Packages that would never
+    // reach a wall are emptied.
+    {
+      namespace stdx = std::experimental;
+      using simd::doubles;
+      using simd::integers;
+      using constants::pi;
+      package_batch& b = batch_;
+      size_t n = (b.size() + simd::width - 1)/simd::width*simd::width;
+      random_numbers_.resize(3*n);
+      rnd_.fill(random_numbers_);
+      at_wall_.resize(n);
+      const double infinity = std::numeric_limits<double>::infinity();
+      const size_t n_points = n_phase_intervals_+1;
+      for (size_t i=0; i<n; i+=simd::width) {
+	auto load = [&](const double* v) {
+	  return doubles(v+i, stdx::element_aligned);
+	};
+	auto gather = [&](const std::vector<double>& v) {
+	  return doubles([&](auto j) { return v[b.layer[i+j]]; });
+	};
+	doubles x = load(b.x.data());
+	doubles y = load(b.y.data());
+	doubles z = load(b.z.data());
+	doubles ux = load(b.ux.data());
+	doubles uy = load(b.uy.data());
+	doubles uz = load(b.uz.data());
+	doubles w = load(b.weight.data());
+	doubles l = load(b.traveling_length.data());
+	doubles tau = load(b.scattering_optical_depth.data());
+	doubles s = gather(scattering_coefficients_);
+	doubles dw = infinity;
+	where(uz > 0, dw) = (gather(tops_)-z)/uz;
+	where(uz < 0, dw) = (z-gather(bottoms_))/(-uz);
+	doubles ds = tau/s;
+	auto is_lost = !(dw < infinity);
+	auto scatters = ds < dw && !is_lost;
+	doubles d = stdx::min(ds, dw);
+	where(is_lost, d) = 0;
+	where(is_lost, w) = 0;
+	w *= simd::exp(-gather(absorption_coefficients_)*d);
+	x += ux*d;
+	y += uy*d;
+	z += uz*d;
+	l += d;
+	tau -= s*d;
+	// Henyey-Greenstein sampling, phase function from the table and
+	// turn by the drawn angles
+	doubles u = load(random_numbers_.data());
+	doubles mu = 1-2*u;
+	doubles sampling_density = 1/(4*pi);
+	if (fabs(g) >= 1e-9) {
+	  doubles a = (1-g*g)/(1-g+2*g*(1-u));
+	  mu = stdx::min(stdx::max((1+g*g-a*a)/(2*g), doubles(-1)), doubles(1));
+	  doubles t = 1+g*g-2*g*mu;
+	  sampling_density = (1-g*g)/(4*pi*t*stdx::sqrt(t));
+	}
+	const double n_intervals = n_phase_intervals_;
+	doubles k = stdx::sqrt(stdx::max((1-mu)/2, doubles(0)))*n_intervals;
+	integers n_low = simd::to_integers(k-0.5);
+	n_low = stdx::min(stdx::max(n_low, integers(0)),
+			  integers(int64_t(n_phase_intervals_)-1));
+	doubles f = k - simd::to_doubles(n_low);
+	doubles p_low([&](auto j) {
+	  return phase_functions_[b.layer[i+j]*n_points + n_low[j]];
+	});
+	doubles p_high([&](auto j) {
+	  return phase_functions_[b.layer[i+j]*n_points + n_low[j] + 1];
+	});
+	where(scatters, w) = w*(p_low + f*(p_high-p_low))/sampling_density;
+	doubles phi = 2*pi*load(random_numbers_.data()+n);
+	doubles cos_phi = stdx::cos(phi);
+	doubles sin_phi = stdx::sin(phi);
+	doubles sin_theta = stdx::sqrt(stdx::max(1-mu*mu, doubles(0)));
+	doubles sin_uz = stdx::sqrt(stdx::max(1-uz*uz, doubles(0)));
+	doubles a = sin_theta/sin_uz;
+	doubles ux_new = a*(ux*uz*cos_phi-uy*sin_phi) + ux*mu;
+	doubles uy_new = a*(uy*uz*cos_phi+ux*sin_phi) + uy*mu;
+	doubles uz_new = -sin_theta*cos_phi*sin_uz + uz*mu;
+	auto is_vertical = uz*uz > (1-1e-10)*(1-1e-10);
+	where(is_vertical, ux_new) = sin_theta*cos_phi;
+	where(is_vertical, uy_new) = sin_theta*sin_phi;
+	where(is_vertical, uz_new) = mu;
+	where(is_vertical && uz < 0, uz_new) = -mu;
+	where(scatters, ux) = ux_new;
+	where(scatters, uy) = uy_new;
+	where(scatters, uz) = uz_new;
+	where(scatters, tau) = -simd::log(load(random_numbers_.data()+2*n));
+	x.copy_to(b.x.data()+i, stdx::element_aligned);
+	y.copy_to(b.y.data()+i, stdx::element_aligned);
+	z.copy_to(b.z.data()+i, stdx::element_aligned);
+	ux.copy_to(b.ux.data()+i, stdx::element_aligned);
+	uy.copy_to(b.uy.data()+i, stdx::element_aligned);
+	uz.copy_to(b.uz.data()+i, stdx::element_aligned);
+	w.copy_to(b.weight.data()+i, stdx::element_aligned);
+	l.copy_to(b.traveling_length.data()+i, stdx::element_aligned);
+	tau.copy_to(b.scattering_optical_depth.data()+i, stdx::element_aligned);
+	auto reaches_wall = !scatters && !is_lost;
+	for (size_t j=0; j<simd::width; ++j)
+	  at_wall_[i+j] = reaches_wall[j];
+      }
+    }
+#endif
+    void interact_with_walls()
+    // Packages marked at walls, sorted by wall so that each coating
+    // handles its packages in a row
+    {
+      package_batch& b = batch_;
+      walls_.assign(layers_.size()+1, 0);
+      auto wall = [&](size_t i) {
+	return b.uz[i] < 0 ? b.layer[i]+1 : b.layer[i];
+      };
+      for (size_t i=0; i<b.size(); ++i)
+	if (at_wall_[i])
+	  walls_[wall(i)+1]++;
+      for (size_t k=1; k<walls_.size(); ++k)
+	walls_[k] += walls_[k-1];
+      sorted_walls_.resize(walls_.back());
+      for (size_t i=0; i<b.size(); ++i)
+	if (at_wall_[i])
+	  sorted_walls_[walls_[wall(i)]++] = i;
+      for (size_t i : sorted_walls_) {
+	package p = b.package(i);
+	if (!interact_with_wall(p))
+	  p.weight = 0;
+	else if (b.scattering_optical_depth[i] <= 0)
+	  throw std::runtime_error("plane_parallel_mc");
+	b.set(i, p);
+      }
+    }
+    void apply_weight_window(package_batch& b, size_t i) {
+      weight_window_.play_russian_roulette(b.weight[i], rnd_);
+      size_t n = weight_window_.split(b.weight[i]);
+      for (size_t k=1; k<n; ++k)
+	bank_.push_back({b.package(i), -log(rnd_(0,1))});
+    }
+    void find_layers()
+    // Layers from the outermost volume down, where empty volumes are
+    // filled with vacuum and uncoated ones get Fresnel coatings
+    {
+      layers_.clear();
+      geometry::volume<flick::content>* v = &outer_volume_;
+      while (true) {
+	if (!v->is_half_space() || v->n_inner_volumes() > 1)
+	  throw std::runtime_error("plane_parallel_mc geometry");
+	flick::content& c = v->content();
+	if (!c.has_material())
+	  c.fill<material::vacuum>();
+	if (!c.has_coating())
+	  c.coat<coating::fresnel>();
+	double top = v->placement().position().z();
+	if (!layers_.empty()) {
+	  if (!(top < layers_.back().top))
+	    throw std::runtime_error("plane_parallel_mc geometry");
+	  layers_.back().bottom = top;
+	}
+	layers_.push_back({top, -std::numeric_limits<double>::infinity(), v,
+	    nullptr, {1,0}, false});
+	if (v->n_inner_volumes() == 0)
+	  break;
+	v = &v->inner_volume(0);
+      }
+    }
+    void compile_medium()
+    // Optical properties of homogeneous materials, and profiles of
+    // materials that change with height only, are read once for each
+    // run. Fresnel interfaces between equal refractive indices,
+    // and at the top of the outermost layer, are crossed directly.
+    {
+      for (auto& l : layers_)
+	l.volume->content().clear_spectrum();
+      bool with_phase_tables =
+	(scattering_sampling_ == scattering_sampling::phase_function);
+      snapshot_ = medium_snapshot(outer_volume_, with_phase_tables);
+      for (size_t i=0; i<layers_.size(); ++i) {
+	layer& l = layers_[i];
+	l.compiled = snapshot_.find(*l.volume);
+	l.refractive_index = l.volume->content().material().refractive_index();
+	bool is_fresnel = dynamic_cast<coating::fresnel*>
+	  (&l.volume->content().coating()) != nullptr;
+	l.has_plain_top = is_fresnel
+	  && (i == 0 || l.refractive_index == layers_[i-1].refractive_index);
+      }
+      if (uses_batches())
+	tabulate_layers();
+    }
+    void tabulate_layers()
+    // Heights and coefficients of the layers, and their phase
+    // functions at equal steps in sin(theta/2)
+    {
+      tops_.clear();
+      bottoms_.clear();
+      absorption_coefficients_.clear();
+      scattering_coefficients_.clear();
+      phase_functions_.clear();
+      for (auto& l : layers_) {
+	tops_.push_back(l.top);
+	bottoms_.push_back(l.bottom);
+	absorption_coefficients_.push_back(l.compiled->absorption_coefficient);
+	scattering_coefficients_.push_back(l.compiled->scattering_coefficient);
+	material::base& m = l.volume->content().material();
+	m.set(pose{});
+	bool scatters = l.compiled->scattering_coefficient > 0;
+	for (size_t i=0; i<=n_phase_intervals_; ++i) {
+	  double s = double(i)/n_phase_intervals_;
+	  double theta = 2*asin(s);
+	  phase_functions_.push_back(scatters ?
+	    m.mueller_matrix(unit_vector{theta,0}).value(0,0) : 0);
+	}
+      }
+    }
+    size_t layer_number(const std::string& volume_name) const {
+      for (size_t i=0; i<layers_.size(); ++i)
+	if (layers_[i].volume->name() == volume_name)
+	  return i;
+      throw std::runtime_error("plane_parallel_mc volume name");
+    }
+    void transport_in_parallel(const emitter& em,
+			       const std::string& emitter_volume_name,
+			       double sampling_asymmetry_factor) {
+      std::vector<emitter> parts = em.split(n_threads_);
+      std::vector<std::shared_ptr<plane_parallel_mc>> workers(n_threads_);
+      for (size_t i=0; i<n_threads_; ++i) {
+	workers[i] = std::make_shared<plane_parallel_mc>(worker_volume(outer_volume_));
+	workers[i]->rnd_ = next_worker_stream();
+	workers[i]->scattering_sampling_ = scattering_sampling_;
+	workers[i]->set_weight_window(weight_window_);
+	workers[i]->batch_size_ = batch_size_;
+      }
+      std::vector<std::exception_ptr> errors(n_threads_);
+      std::vector<std::thread> threads;
+      for (size_t i=0; i<n_threads_; ++i) {
+	threads.emplace_back([&, i]() {
+	  try {
+	    workers[i]->transport_radiation(parts[i],emitter_volume_name,
+					    sampling_asymmetry_factor);
+	  } catch (...) {
+	    errors[i] = std::current_exception();
+	  }
+	});
+      }
+      for (auto& t : threads)
+	t.join();
+      for (auto& e : errors)
+	if (e)
+	  std::rethrow_exception(e);
+      for (size_t i=0; i<n_threads_; ++i) {
+	merge_receivers(outer_volume_, workers[i]->outer_volume_);
+	weight_window_.add_statistics(workers[i]->variance_reduction_statistics());
+      }
+    }
+    uniform_random next_worker_stream() {
+      return rnd_.stream(rnd_.stream_number() + ++n_worker_streams_);
+    }
+  };
+}
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "plane_parallel_mc.hpp"
+#include "ordinary_mc.hpp"
+#include "../material/henyey_greenstein.hpp"
+
+namespace flick {
+  semi_infinite_box two_layer_slab() {
+    semi_infinite_box air;
+    air.name("air");
+    air.move_by({0,0,3});
+    semi_infinite_box upper;
+    upper.name("upper");
+    upper.move_by({0,0,2});
+    upper().fill<material::henyey_greenstein>(0.1,2.0,0.8,1.33);
+    upper().outward_receiver().activate();
+    semi_infinite_box lower;
+    lower.name("lower");
+    lower.move_by({0,0,1});
+    lower().fill<material::henyey_greenstein>(0.3,1.0,0.5,1.33);
+    lower().inward_receiver().activate();
+    semi_infinite_box bottom;
+    bottom.name("bottom");
+    bottom().coat<coating::grey_lambert>(0.5,0);
+    lower.insert(bottom);
+    upper.insert(lower);
+    air.insert(upper);
+    return air;
+  }
+
+  template<class Transporter>
+  std::pair<double,double> two_layer_slab_fluxes(size_t batch_size=1) {
+    Transporter t{two_layer_slab()};
+    t.set_seed(1);
+    if constexpr (std::is_same_v<Transporter,transporter::plane_parallel_mc>)
+      t.set_batch_size(batch_size);
+    size_t n = 40000;
+    emitter em{{0,0,2.5},n};
+    em.set_direction<unidirectional>(unit_vector{constants::pi-0.5,0});
+    t.transport_radiation(em,"air");
+    return {t.outward_receiver("upper").radiant_flux()/n,
+	    t.inward_receiver("lower").radiant_flux()/n};
+  }
+
+  begin_test_case(plane_parallel_mc_test_A) {
+    // Reflected and transmitted flux should agree with the generic
+    // transporter. Their speeds are compared in the model benchmarks.
+    auto generic = two_layer_slab_fluxes<transporter::ordinary_mc>();
+    auto kernel = two_layer_slab_fluxes<transporter::plane_parallel_mc>();
+    check_close(kernel.first, generic.first, 5.0_pct);
+    check_close(kernel.second, generic.second, 2.0_pct);
+  } end_test_case()
+
+  begin_test_case(plane_parallel_mc_test_B) {
+    // Without scattering, paths are the same as for the generic
+    // transporter, including total internal reflection at the top of
+    // an inner layer
+    auto received = [](auto& t) {
+      emitter em{{0,0,1.5},1};
+      em.set_direction<unidirectional>(unit_vector{0.9,0.3});
+      t.transport_radiation(em,"upper");
+      return std::vector<double>{t.inward_receiver("upper").radiant_flux(),
+	t.outward_receiver("upper").radiant_flux(),
+	t.inward_receiver("lower").radiant_flux()};
+    };
+    semi_infinite_box air;
+    air.name("air");
+    air.move_by({0,0,3});
+    semi_infinite_box upper;
+    upper.name("upper");
+    upper.move_by({0,0,2});
+    upper().fill<material::henyey_greenstein>(0.1,0.0,0.8,1.33);
+    upper().inward_receiver().activate();
+    upper().outward_receiver().activate();
+    semi_infinite_box lower;
+    lower.name("lower");
+    lower.move_by({0,0,1});
+    lower().fill<material::henyey_greenstein>(0.0,0.0,0.8,1.33);
+    lower().inward_receiver().activate();
+    upper.insert(lower);
+    air.insert(upper);
+    transporter::ordinary_mc omc{air};
+    transporter::plane_parallel_mc ppmc{air};
+    std::vector<double> generic = received(omc);
+    std::vector<double> kernel = received(ppmc);
+    for (size_t i=0; i<generic.size(); ++i)
+      check(fabs(kernel[i]-generic[i]) < 1e-12);
+    check_close(kernel[0], exp(-0.1*0.5/cos(0.9)), 1e-9);
+  } end_test_case()
+
+  begin_test_case(plane_parallel_mc_test_C) {
+    // Only stacks of semi-infinite boxes are plane-parallel
+    semi_infinite_box box;
+    box.insert(sphere(1));
+    check_throw(transporter::plane_parallel_mc{box});
+  } end_test_case()
+
+  begin_test_case(plane_parallel_mc_test_D) {
+    // Packages moved in batches give the same fluxes as packages
+    // followed one at a time
+    auto single = two_layer_slab_fluxes<transporter::plane_parallel_mc>();
+    auto batched = two_layer_slab_fluxes<transporter::plane_parallel_mc>(256);
+    check_close(batched.first, single.first, 5.0_pct);
+    check_close(batched.second, single.second, 2.0_pct);
+    check_throw(transporter::plane_parallel_mc{two_layer_slab()}.set_batch_size(0));
+  } end_test_case()
+}
@@ -1,5 +1,6 @@
 #include "../environment/unit_test.hpp"
 #include "ordinary_mc_test.hpp"
+#include "plane_parallel_mc_test.hpp"
 
 int main() {
   using namespace flick;
@@ -10,6 +11,29 @@ int main() {
   t.include<ordinary_mc_test_C>("ordinary_mc_test_C");
   t.include<ordinary_mc_test_D>("ordinary_mc_test_D");
   t.include<ordinary_mc_test_E>("ordinary_mc_test_E");
+  t.include<ordinary_mc_test_F>("ordinary_mc_test_F");
+  t.include<ordinary_mc_test_G>("ordinary_mc_test_G");
+  t.include<ordinary_mc_test_H>("ordinary_mc_test_H");
+  t.include<ordinary_mc_test_I>("ordinary_mc_test_I");
+  t.include<ordinary_mc_test_J>("ordinary_mc_test_J");
+  t.include<ordinary_mc_test_K>("ordinary_mc_test_K");
+  t.include<ordinary_mc_test_L>("ordinary_mc_test_L");
+  t.include<ordinary_mc_test_M>("ordinary_mc_test_M");
+  t.include<ordinary_mc_test_N>("ordinary_mc_test_N");
+  t.include<ordinary_mc_test_O>("ordinary_mc_test_O");
+  t.include<ordinary_mc_test_P>("ordinary_mc_test_P");
+  t.include<ordinary_mc_test_Q>("ordinary_mc_test_Q");
+  t.include<ordinary_mc_test_R>("ordinary_mc_test_R");
+  t.include<ordinary_mc_test_S>("ordinary_mc_test_S");
+  t.include<ordinary_mc_test_T>("ordinary_mc_test_T");
+  t.include<ordinary_mc_test_U>("ordinary_mc_test_U");
+  t.include<ordinary_mc_test_V>("ordinary_mc_test_V");
+  t.include<ordinary_mc_test_W>("ordinary_mc_test_W");
+  t.include<ordinary_mc_test_X>("ordinary_mc_test_X");
+  t.include<plane_parallel_mc_test_A>("plane_parallel_mc_test_A");
+  t.include<plane_parallel_mc_test_B>("plane_parallel_mc_test_B");
+  t.include<plane_parallel_mc_test_C>("plane_parallel_mc_test_C");
+  t.include<plane_parallel_mc_test_D>("plane_parallel_mc_test_D");
 
   t.run_test_cases();
   return 0;
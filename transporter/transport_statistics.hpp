@@ -0,0 +1,156 @@
+#ifndef flick_transport_statistics
+#define flick_transport_statistics
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include "../environment/input_output.hpp"
+
+// Compile with -DFLICK_TRANSPORT_STATISTICS=0 to remove counting and
+// timing from the transporters
+#ifndef FLICK_TRANSPORT_STATISTICS
+#define FLICK_TRANSPORT_STATISTICS 1
+#endif
+
+namespace flick {
+namespace transporter {
+  constexpr bool has_transport_statistics = FLICK_TRANSPORT_STATISTICS;
+
+  enum class transport_phase
+  // Coarse parts of transport that time is spent in. Sampling is
+  // emission and drawing of free paths, geometry is finding walls and
+  // interacting with them, material is evaluation of optical
+  // properties and phase functions, and receiver is receiving and
+  // scoring of packages.
+  {sampling, geometry, material, receiver};
+
+  class transport_statistics
+  // Events counted during transport, and time spent in each phase.
+  // Times of runs in several threads are summed over threads.
+  {
+    using clock = std::chrono::steady_clock;
+    static constexpr size_t n_phases_ = 4;
+    std::array<double, n_phases_> seconds_{};
+    transport_phase phase_{transport_phase::sampling};
+    clock::time_point phase_start_;
+  public:
+    size_t packages{0};
+    size_t steps{0};
+    size_t scattering_events{0};
+    size_t reflections{0};
+    size_t transmissions{0};
+    size_t escaped{0};
+    size_t absorbed_at_walls{0};
+    size_t absorbed_in_media{0};
+    size_t roulette_kills{0};
+    size_t diffusion_steps{0};
+    void start(transport_phase p) {
+      phase_ = p;
+      phase_start_ = clock::now();
+    }
+    transport_phase enter(transport_phase p)
+    // Time since the last change is given to the current phase,
+    // which is returned
+    {
+      clock::time_point now = clock::now();
+      transport_phase previous = phase_;
+      seconds_[static_cast<size_t>(phase_)] +=
+	std::chrono::duration<double>(now - phase_start_).count();
+      phase_ = p;
+      phase_start_ = now;
+      return previous;
+    }
+    void stop() {
+      enter(phase_);
+    }
+    double seconds(transport_phase p) const {
+      return seconds_[static_cast<size_t>(p)];
+    }
+    size_t wall_interactions() const {
+      return reflections + transmissions + absorbed_at_walls;
+    }
+    size_t absorptions() const
+    // Packages ended by absorption at opaque walls, or by weight
+    // becoming negligible in absorbing media
+    {
+      return absorbed_at_walls + absorbed_in_media;
+    }
+    size_t terminations() const {
+      return escaped + absorptions() + roulette_kills;
+    }
+    double mean_steps() const
+    // Steps per followed package, including copies from splitting
+    {
+      if (packages == 0)
+	return 0;
+      return double(steps)/packages;
+    }
+    void add(const transport_statistics& s) {
+      packages += s.packages;
+      steps += s.steps;
+      scattering_events += s.scattering_events;
+      reflections += s.reflections;
+      transmissions += s.transmissions;
+      escaped += s.escaped;
+      absorbed_at_walls += s.absorbed_at_walls;
+      absorbed_in_media += s.absorbed_in_media;
+      roulette_kills += s.roulette_kills;
+      diffusion_steps += s.diffusion_steps;
+      for (size_t i=0; i<n_phases_; ++i)
+	seconds_[i] += s.seconds_[i];
+    }
+    void clear() {
+      *this = transport_statistics{};
+    }
+    void write_state(std::ostream& os) const
+    // Counts and phase times, without the running phase clock
+    {
+      write_binary(os, counts());
+      write_binary(os, seconds_);
+    }
+    void read_state(std::istream& is) {
+      std::array<size_t, 10> c;
+      read_binary(is, c);
+      packages = c[0];
+      steps = c[1];
+      scattering_events = c[2];
+      reflections = c[3];
+      transmissions = c[4];
+      escaped = c[5];
+      absorbed_at_walls = c[6];
+      absorbed_in_media = c[7];
+      roulette_kills = c[8];
+      diffusion_steps = c[9];
+      read_binary(is, seconds_);
+    }
+    friend std::ostream& operator<<(std::ostream &os,
+				    const transport_statistics& s) {
+      using enum transport_phase;
+      os << "packages " << s.packages << '\n'
+	 << "steps " << s.steps << '\n'
+	 << "mean_steps_per_package " << s.mean_steps() << '\n'
+	 << "scattering_events " << s.scattering_events << '\n'
+	 << "diffusion_steps " << s.diffusion_steps << '\n'
+	 << "wall_reflections " << s.reflections << '\n'
+	 << "wall_transmissions " << s.transmissions << '\n'
+	 << "terminated_escaped " << s.escaped << '\n'
+	 << "terminated_absorbed_at_walls " << s.absorbed_at_walls << '\n'
+	 << "terminated_absorbed_in_media " << s.absorbed_in_media << '\n'
+	 << "terminated_roulette " << s.roulette_kills << '\n'
+	 << "seconds_sampling " << s.seconds(sampling) << '\n'
+	 << "seconds_geometry " << s.seconds(geometry) << '\n'
+	 << "seconds_material " << s.seconds(material) << '\n'
+	 << "seconds_receiver " << s.seconds(receiver);
+      return os;
+    }
+  private:
+    std::array<size_t, 10> counts() const {
+      return {packages, steps, scattering_events, reflections, transmissions,
+	escaped, absorbed_at_walls, absorbed_in_media, roulette_kills,
+	diffusion_steps};
+    }
+  };
+}
+}
+
+#endif
@@ -4,12 +4,29 @@
 #include "../geometry/volume.hpp"
 #include "../component/content.hpp"
 #include "../component/emitter.hpp"
+#include "transport_statistics.hpp"
 
 namespace flick {
   using cube = geometry::cube<content>;
   using sphere = geometry::sphere<content>;
   using semi_infinite_box = geometry::semi_infinite_box<content>;
 
+  inline void align_with_plane_of_incidence(radiation_package& rp,
+					    const unit_vector& surface_normal)
+  // Rotates rp about its direction so that its x axis is normal to
+  // the plane of incidence, the frame of the Fresnel Mueller matrices
+  {
+    pose p = rp.pose();
+    vector normal = cross(p.z_direction(),surface_normal);
+    if (norm(normal) > std::numeric_limits<double>::epsilon()*10) {
+      double d = dot(normalize(normal),p.x_direction());
+      if (d <= 1 && d >= -1) // avoid rounding errors
+	rp.rotate_about_local_z(acos(d));
+      if (dot(normal,rp.pose().x_direction()) < 0)
+	rp.rotate_about_local_z(constants::pi/2);
+    }
+  }
+
   class wall_interactor {
     geometry::navigator<content>& nav_;
     std::optional<pose> next_wall_intersection_;
@@ -21,12 +38,19 @@ namespace flick {
     bool is_reflected_{false};
     bool is_transmitted_{true};
     bool is_moving_inward_;
+    bool is_split_{false};
     unit_vector facing_surface_normal_;
+    std::optional<radiation_package> reflected_package_;
+    geometry::volume<content>* reflected_volume_{nullptr};
+    transporter::transport_statistics* statistics_;
   public:
     wall_interactor(geometry::navigator<content>& nav,
 		    radiation_package& rp,
-		    uniform_random& ur)
-      : nav_{nav}, rp_{rp}, rnd_{ur} {   
+		    uniform_random& ur,
+		    transporter::transport_statistics* statistics = nullptr)
+    // Interactions and time spent receiving are added to statistics
+    // when given
+      : nav_{nav}, rp_{rp}, rnd_{ur}, statistics_{statistics} {   
       next_wall_intersection_ = nav_.next_intersection(rp_.pose());
       if (not next_wall_intersection_.has_value())
 	 throw std::runtime_error("wall_interactor");
@@ -52,44 +76,141 @@ namespace flick {
 	is_transmitted_ = (1-r < coating_->unpolarized_transmittance());
       }
     }
+    bool can_split()
+    // Both the reflected and the transmitted package would carry
+    // weight
+    {
+      if (coating_==nullptr)
+	return false;
+      radiation_package reflected = rp_;
+      radiation_package transmitted = rp_;
+      reflected.scale_intensity(coating_->unpolarized_reflectance());
+      transmitted.scale_intensity(coating_->unpolarized_transmittance());
+      return !reflected.is_empty() && !transmitted.is_empty();
+    }
+    void split()
+    // Follow both the reflected and the transmitted package, weighted
+    // by reflectance and transmittance instead of drawn with these
+    // probabilities. The reflected package is available after
+    // interaction.
+    {
+      if (!can_split())
+	throw std::runtime_error("wall_interactor split");
+      is_split_ = true;
+    }
     void interact_with_wall() {
       nav_.go_to(*next_volume_);
-      if (is_reflected_) {
-	rp_.interact_with_matter(coating_->reflection_mueller_matrix());
-	rp_.scale_intensity(1/coating_->unpolarized_reflectance());
-	rp_.rotate_to(coating_->reflection_rotation());
-	receive_reflected_packages();
-	step_back_from_wall();
+      if (is_split_) {
+	radiation_package incident = rp_;
+	is_reflected_ = true;
+	reflect();
+	reflected_package_ = rp_;
+	reflected_volume_ = &nav_.current_volume();
+	rp_ = incident;
+	is_reflected_ = false;
+	nav_.go_to(*next_volume_);
+	transmit();
+      }
+      else if (is_reflected_) {
+	reflect();
       }
       else if (is_transmitted_) {
-	receive_transmitted_packages();
-	if (coating_!=nullptr) {
-	  rp_.interact_with_matter(coating_->transmission_mueller_matrix());
-	  rp_.scale_intensity(1/coating_->unpolarized_transmittance());
-	  rp_.rotate_to(coating_->transmission_rotation());
-	}
-	step_through_wall();
-	nav_.go_to(*next_volume_);
+	transmit();
       }
       else {
-	receive_transmitted_packages();
+	receive_transmitted_packages(rp_);
 	absorb_radiation_package();
       }
     }
+    coating::base& coating() const {
+      return *coating_;
+    }
+    const unit_vector& surface_normal() const
+    // Facing the incident package
+    {
+      return facing_surface_normal_;
+    }
+    geometry::volume<content>& current_volume() const {
+      return *current_volume_;
+    }
+    geometry::volume<content>& next_volume() const {
+      return *next_volume_;
+    }
+    const std::optional<radiation_package>& reflected_package() const {
+      return reflected_package_;
+    }
+    geometry::volume<content>& reflected_volume() const {
+      return *reflected_volume_;
+    }
   private:
+    void reflect() {
+      if (statistics_)
+	statistics_->reflections++;
+      std::vector<double> r = spectrum_ratios(true);
+      for (size_t i=0; i<r.size(); ++i)
+	rp_.scale_spectrum(i, r[i], is_split_ ? 1 : r[i]);
+      rp_.interact_with_matter(coating_->reflection_mueller_matrix());
+      if (!is_split_)
+	rp_.scale_intensity(1/coating_->unpolarized_reflectance());
+      rp_.rotate_to(coating_->reflection_rotation());
+      receive_reflected_packages();
+      step_back_from_wall();
+      nav_.go_to(*current_volume_);
+    }
+    void transmit()
+    // Transmitted packages are received before interaction with the
+    // coating. Split packages are received with the transmitted part
+    // of their weight.
+    {
+      if (statistics_)
+	statistics_->transmissions++;
+      if (coating_==nullptr) {
+	receive_transmitted_packages(rp_);
+      } else {
+	std::vector<double> t = spectrum_ratios(false);
+	if (is_split_) {
+	  radiation_package received = rp_;
+	  received.scale_intensity(coating_->unpolarized_transmittance());
+	  for (size_t i=0; i<t.size(); ++i)
+	    received.scale_spectrum(i, t[i], 1);
+	  receive_transmitted_packages(received);
+	} else {
+	  for (size_t i=0; i<t.size(); ++i)
+	    rp_.scale_spectrum(i, 1, t[i]);
+	  receive_transmitted_packages(rp_);
+	}
+	t = spectrum_ratios(true);
+	for (size_t i=0; i<t.size(); ++i)
+	  rp_.scale_spectrum(i, t[i], 1);
+	rp_.interact_with_matter(coating_->transmission_mueller_matrix());
+	if (!is_split_)
+	  rp_.scale_intensity(1/coating_->unpolarized_transmittance());
+	rp_.rotate_to(coating_->transmission_rotation());
+      }
+      step_through_wall();
+      nav_.go_to(*next_volume_);
+    }
     void receive_reflected_packages() {
-      if (is_moving_inward_)
-	next_volume_->content().outward_receiver().receive(rp_);
-      else
-	current_volume_->content().inward_receiver().receive(rp_);
+      receive(is_moving_inward_ ? next_volume_->content().outward_receiver()
+	      : current_volume_->content().inward_receiver(), rp_);
     }
-    void receive_transmitted_packages() {
-      if (is_moving_inward_)
-	next_volume_->content().inward_receiver().receive(rp_);
-      else
-	current_volume_->content().outward_receiver().receive(rp_);
+    void receive_transmitted_packages(const radiation_package& rp) {
+      receive(is_moving_inward_ ? next_volume_->content().inward_receiver()
+	      : current_volume_->content().outward_receiver(), rp);
+    }
+    void receive(receiver& re, const radiation_package& rp) {
+      if (!statistics_ || !re.is_active()) {
+	re.receive(rp);
+	return;
+      }
+      transporter::transport_phase p =
+	statistics_->enter(transporter::transport_phase::receiver);
+      re.receive(rp);
+      statistics_->enter(p);
     }
     void absorb_radiation_package() {
+      if (statistics_)
+	statistics_->absorbed_at_walls++;
       rp_.scale_intensity(0);
     }
     void set_coating() {
@@ -114,6 +235,42 @@ namespace flick {
 	content().material().refractive_index();
       return m2 / m1;
     }
+    std::vector<double> spectrum_ratios(bool same_direction)
+    // Reflectance or transmittance of companion wavelengths relative
+    // to the hero. With same_direction, companions reflected or
+    // refracted into other directions than the hero get zero. Empty
+    // for monochromatic packages.
+    {
+      std::vector<double> ratios;
+      if (!rp_.is_spectral() || !current_volume_->content().has_spectrum()
+	  || !next_volume_->content().has_spectrum())
+	return ratios;
+      double p_hero = hero_probability();
+      unit_vector d_hero = hero_direction();
+      for (size_t i=0; i<rp_.n_wavelengths(); ++i) {
+	std::complex<double> m1 = current_volume_->
+	  content().material(i).refractive_index();
+	std::complex<double> m2 = next_volume_->
+	  content().material(i).refractive_index();
+	coating_->set(m2/m1);
+	double p = hero_probability();
+	if (same_direction && p > 0 && dot(hero_direction(),d_hero) < 1-1e-12)
+	  p = 0;
+	ratios.push_back(p/p_hero);
+      }
+      coating_->set(relative_refractive_index());
+      return ratios;
+    }
+    double hero_probability() {
+      if (is_reflected_)
+	return coating_->unpolarized_reflectance();
+      return coating_->unpolarized_transmittance();
+    }
+    unit_vector hero_direction() {
+      if (is_reflected_)
+	return coating_->reflection_rotation().z_direction();
+      return coating_->transmission_rotation().z_direction();
+    }
     void move_to_wall() {
       rp_.move_to((*next_wall_intersection_).position());
     }
@@ -123,18 +280,8 @@ namespace flick {
     void step_through_wall() {
       rp_.move_by(-current_volume_->small_step()*facing_surface_normal_);
     }    
-    void align_rp_x_axis_with_plane_of_incidence()
-    // Not too proud over this one..
-    {
-      pose p = rp_.pose();
-      vector normal = cross(p.z_direction(),facing_surface_normal_);
-      if (norm(normal) > std::numeric_limits<double>::epsilon()*10) {
-	double d = dot(normalize(normal),p.x_direction());
-	if (d <= 1 && d >= -1) // avoid rounding errors
-	  rp_.rotate_about_local_z(acos(d));
-	if (dot(normal,rp_.pose().x_direction()) < 0)
-	  rp_.rotate_about_local_z(constants::pi/2);
-      }
+    void align_rp_x_axis_with_plane_of_incidence() {
+      align_with_plane_of_incidence(rp_, facing_surface_normal_);
     }
     unit_vector facing_surface_normal() const {
       unit_vector n = (*next_wall_intersection_).z_direction();
@@ -0,0 +1,124 @@
+#ifndef flick_weight_window
+#define flick_weight_window
+
+#include <limits>
+#include "../component/radiation_package.hpp"
+
+namespace flick {
+namespace transporter {
+  struct weight_window_statistics {
+    size_t roulette_games{0};
+    size_t roulette_kills{0};
+    size_t splittings{0};
+    size_t split_packages{0};
+    size_t interface_splittings{0};
+    void add(const weight_window_statistics& s) {
+      roulette_games += s.roulette_games;
+      roulette_kills += s.roulette_kills;
+      splittings += s.splittings;
+      split_packages += s.split_packages;
+      interface_splittings += s.interface_splittings;
+    }
+  };
+
+  class weight_window
+  // Russian roulette for packages with weight below a threshold, and
+  // splitting of packages with weight above a threshold. Survivors of
+  // roulette get the survival weight and split packages share their
+  // weight equally, so that expected weights are unchanged. Disabled
+  // by default.
+  {
+    double roulette_threshold_{0};
+    double survival_weight_{0};
+    double splitting_threshold_{std::numeric_limits<double>::infinity()};
+    size_t max_copies_{1};
+    bool interface_splitting_{false};
+    weight_window_statistics statistics_;
+  public:
+    void set_russian_roulette(double threshold, double survival_weight) {
+      if (threshold < 0 || (threshold > 0 && survival_weight < threshold))
+	throw std::runtime_error("weight_window roulette");
+      roulette_threshold_ = threshold;
+      survival_weight_ = survival_weight;
+    }
+    void set_splitting(double threshold, size_t max_copies)
+    // Packages with weight above threshold are split into at most
+    // max_copies packages
+    {
+      if (!(threshold > 0) || max_copies < 1
+	  || threshold <= roulette_threshold_)
+	throw std::runtime_error("weight_window splitting");
+      splitting_threshold_ = threshold;
+      max_copies_ = max_copies;
+    }
+    void set_interface_splitting(bool on)
+    // Follow both reflected and transmitted packages at interfaces
+    // instead of drawing one of them
+    {
+      interface_splitting_ = on;
+    }
+    bool splits_at_interfaces() const {
+      return interface_splitting_;
+    }
+    friend std::ostream& operator<<(std::ostream& os, const weight_window& w) {
+      os << w.roulette_threshold_ << " " << w.survival_weight_ << " "
+	 << w.splitting_threshold_ << " " << w.max_copies_ << " "
+	 << w.interface_splitting_;
+      return os;
+    }
+    void play_russian_roulette(radiation_package& rp, const uniform_random& rnd)
+    // Draws a random number only when the game is played
+    {
+      double w = rp.weight();
+      double w_new = w;
+      play_russian_roulette(w_new, rnd);
+      if (w_new != w)
+	rp.scale_intensity(w_new/w);
+    }
+    void play_russian_roulette(double& weight, const uniform_random& rnd) {
+      if (!(weight > 0) || weight >= roulette_threshold_)
+	return;
+      statistics_.roulette_games++;
+      if (rnd() < weight/survival_weight_) {
+	weight = survival_weight_;
+      } else {
+	weight = 0;
+	statistics_.roulette_kills++;
+      }
+    }
+    size_t split(radiation_package& rp)
+    // Returns the number of copies rp should be followed as, and
+    // scales its weight accordingly
+    {
+      double w = rp.weight();
+      size_t n = split(w);
+      if (n > 1)
+	rp.scale_intensity(1.0/n);
+      return n;
+    }
+    size_t split(double& weight) {
+      if (weight <= splitting_threshold_ || max_copies_ < 2)
+	return 1;
+      size_t n = std::min<double>(ceil(weight/splitting_threshold_), max_copies_);
+      weight /= n;
+      statistics_.splittings++;
+      statistics_.split_packages += n-1;
+      return n;
+    }
+    void count_interface_splitting() {
+      statistics_.interface_splittings++;
+    }
+    const weight_window_statistics& statistics() const {
+      return statistics_;
+    }
+    void add_statistics(const weight_window_statistics& s) {
+      statistics_.add(s);
+    }
+    void clear_statistics() {
+      statistics_ = weight_window_statistics();
+    }
+  };
+}
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef flick_workers
+#define flick_workers
+
+#include "../geometry/volume.hpp"
+#include "../component/content.hpp"
+
+namespace flick {
+namespace transporter {
+  inline void prepare_for_worker(geometry::volume<content>& v) {
+    v.content().detach();
+    v.content().inward_receiver().clear();
+    v.content().outward_receiver().clear();
+    for (size_t i=0; i<v.n_inner_volumes(); ++i)
+      prepare_for_worker(v.inner_volume(i));
+  }
+  inline geometry::volume<content> worker_volume(const geometry::volume<content>& outer)
+  // Copy of a volume tree with its own materials, coatings and empty
+  // receivers, for transport in another thread
+  {
+    geometry::volume<content> v = outer;
+    v.detach();
+    prepare_for_worker(v);
+    return v;
+  }
+  inline void merge_receivers(geometry::volume<content>& to,
+			      geometry::volume<content>& from)
+  // Adds the receivers of a worker's volume tree to those of to
+  {
+    to.content().inward_receiver().add(from.content().inward_receiver());
+    to.content().outward_receiver().add(from.content().outward_receiver());
+    for (size_t i=0; i<to.n_inner_volumes(); ++i)
+      merge_receivers(to.inner_volume(i), from.inner_volume(i));
+  }
+  inline void write_receivers(std::ostream& os, geometry::volume<content>& v)
+  // State of the receivers of a volume tree, in tree order
+  {
+    v.content().inward_receiver().write_state(os);
+    v.content().outward_receiver().write_state(os);
+    for (size_t i=0; i<v.n_inner_volumes(); ++i)
+      write_receivers(os, v.inner_volume(i));
+  }
+  inline void read_receivers(std::istream& is, geometry::volume<content>& v) {
+    v.content().inward_receiver().read_state(is);
+    v.content().outward_receiver().read_state(is);
+    for (size_t i=0; i<v.n_inner_volumes(); ++i)
+      read_receivers(is, v.inner_volume(i));
+  }
+  inline void flush_receivers(geometry::volume<content>& v)
+  // Writes packages buffered by streaming receivers of a volume tree
+  {
+    v.content().inward_receiver().flush();
+    v.content().outward_receiver().flush();
+    for (size_t i=0; i<v.n_inner_volumes(); ++i)
+      flush_receivers(v.inner_volume(i));
+  }
+}
+}
+
+#endif